@@ -0,0 +1,84 @@
+/*
+    Example for a fixed-rate control loop on the Dynamixel MX28-AT series servos
+    
+	Serial:
+	GPIO UART: "/dev/ttyTHS0" "/dev/ttyTHS1" "/dev/ttyTHS2"
+	USB  UART: "/dev/ttyUSB0"
+
+    Jetson Pins:
+    gpio57  or 57,    // J3A1 - Pin 50
+	gpio160 or 160,	  // J3A2 - Pin 40	
+	gpio161 or 161,    // J3A2 - Pin 43
+	gpio162 or 162,    // J3A2 - Pin 46
+	gpio163 or 163,    // J3A2 - Pin 49
+	gpio164 or 164,    // J3A2 - Pin 52
+	gpio165 or 165,    // J3A2 - Pin 55
+	gpio166 or 166     // J3A2 - Pin 58
+	
+	*Sweeps the servos back and forth from a 500 Hz loop and prints the timing
+		loop.setServos(IDs, Count)	: servos read and written every cycle
+		loop.setPeriod(Period)		: period in micro seconds
+		loop.setRealtime(Priority)	: SCHED_FIFO priority, needs root or CAP_SYS_NICE
+		loop.setCPU(CPU)			: pins the loop to one CPU
+		loop.setLockMemory(ON)		: mlockall before starting
+		loop.run(Callback, User, Cycles): runs the loop
+		loop.printStats()			: overruns and jitter percentiles
+*/
+
+#include<iostream>
+#include "JetsonMX28Loop.h"
+
+#define SERVOS 3    // Number of servos on the bus
+#define USB 1   	// 1 for GPIO, 0 for USB
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+// Moves every servo 4 positions per cycle between 1024 and 3072
+int sweep(MX28LoopCycle *Cycle, void *User)
+{
+    int *Step = (int *)User;
+    
+    for(int servo = 0; servo < Cycle->Count; servo++)
+    {
+        if(Cycle->Positions[servo] >= 0)
+            Cycle->Positions[servo] += *Step;
+    }
+    
+    if( (Cycle->Positions[0] >= 3072) | ((Cycle->Positions[0] >= 0) & (Cycle->Positions[0] <= 1024)) )
+        *Step = -(*Step);
+    
+    return 0;
+}
+
+int main()
+{
+    JetsonMX28 control;
+    JetsonMX28Loop loop(control);
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3};
+    int Step = 4;
+
+#if USB
+	control.begin("/dev/ttyUSB0", B1000000);
+#else 
+	control.begin("/dev/ttyTHS0", B1000000, 166);
+#endif
+
+    for(int servo = 0; servo < SERVOS; servo++)
+	    control.setEndless(IDs[servo], OFF); // Sets the servos to "Servo" mode
+    
+    loop.setServos(IDs, SERVOS);
+    loop.setPeriod(2*MSEC);
+    loop.setRealtime(80);
+    loop.setCPU(3);
+    loop.setLockMemory(ON);
+    
+    loop.run(sweep, &Step, 5000);
+    loop.printStats();
+    
+    control.disconnect();
+    
+    return 0;
+}
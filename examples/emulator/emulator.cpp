@@ -0,0 +1,76 @@
+/*
+    Example for running the library against virtual MX28-AT servos, no hardware needed
+    
+	*The emulator answers on a pseudo terminal that is passed to begin() like a USB UART
+		emulator.begin(Servos, FirstID): opens the pseudo terminal with IDs FirstID and up
+		emulator.path()			: device name for JetsonMX28::begin()
+		emulator.start()		: answers packets on a background thread
+		emulator.setFaults(Faults): lost packets, lost bytes, bad checksums and late replies
+		emulator.setOnline(ID, OFF): takes a servo off the bus
+		
+	*Run "./emulator serve" to only serve the bus, for another program to connect to
+*/
+
+#include<iostream>
+#include "JetsonMX28Emulator.h"
+
+#define SERVOS 4    // Number of virtual servos
+#define READS 1000  // Reads in the benchmark
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    JetsonMX28Emulator emulator;
+    JetsonMX28 control;
+    MX28State State;
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3, 4};
+    int Positions[SERVOS] = {1024, 1024, 3072, 3072};
+
+    if(emulator.begin(SERVOS) < 0)
+        return 1;
+    
+    if( (argc > 1) && (string(argv[1]) == "serve") )
+    {
+        cout << "Serving " << SERVOS << " servos on " << emulator.path() << endl;
+        while(1)
+            emulator.poll(1000);
+    }
+    
+    emulator.start();
+	control.begin(emulator.path(), B1000000);
+	
+    for(int servo = 0; servo < SERVOS; servo++)
+        control.setRDT(IDs[servo], 0);      // Answer right away
+    
+    control.syncMove(IDs, Positions, SERVOS);
+    usleep(500*MSEC);
+    for(int servo = 0; servo < SERVOS; servo++)
+    {
+        control.readState(IDs[servo], &State);
+        cout << "ID " << (int)IDs[servo] << " position " << State.Position << " moving " << State.Moving << endl;
+    }
+    
+    control.resetStats();
+    for(int i = 0; i < READS; i++)
+        control.readPosition(IDs[i % SERVOS]);
+    cout << "Clean bus:" << endl;
+    control.printStats();
+    
+    MX28Faults Faults = {0.02, 0.02, 0.02, 0.02, 20*MSEC};
+    emulator.setFaults(Faults);
+    control.setRetries(2);
+    control.resetStats();
+    for(int i = 0; i < READS; i++)
+        control.readPosition(IDs[i % SERVOS]);
+    cout << "Noisy bus:" << endl;
+    control.printStats();
+    
+    control.disconnect();
+    emulator.disconnect();
+    
+    return 0;
+}
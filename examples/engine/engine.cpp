@@ -0,0 +1,76 @@
+/*
+    Example for driving the Dynamixel MX28-AT series servos from a background engine
+    
+	Serial:
+	GPIO UART: "/dev/ttyTHS0" "/dev/ttyTHS1" "/dev/ttyTHS2"
+	USB  UART: "/dev/ttyUSB0"
+
+    Jetson Pins:
+    gpio57  or 57,    // J3A1 - Pin 50
+	gpio160 or 160,	  // J3A2 - Pin 40	
+	gpio161 or 161,    // J3A2 - Pin 43
+	gpio162 or 162,    // J3A2 - Pin 46
+	gpio163 or 163,    // J3A2 - Pin 49
+	gpio164 or 164,    // J3A2 - Pin 52
+	gpio165 or 165,    // J3A2 - Pin 55
+	gpio166 or 166     // J3A2 - Pin 58
+	
+	*The engine owns the bus on its own thread, none of these calls wait on the UART
+		engine.start(Period)	: starts the engine thread, Period in micro seconds
+		engine.watch(ID, ON)	: reads the state of ID every cycle
+		engine.move(ID, Position): queues a goal position
+		engine.readState(ID, &State): copies the latest state of ID
+		engine.stop()			: sends what is still queued and stops the thread
+*/
+
+#include<iostream>
+#include "JetsonMX28Engine.h"
+
+#define SERVOS 3    // Number of servos on the bus
+#define USB 1   	// 1 for GPIO, 0 for USB
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+int main()
+{
+    JetsonMX28 control;
+    JetsonMX28Engine engine(control);
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3};
+    MX28State State;
+
+#if USB
+	control.begin("/dev/ttyUSB0", B1000000);
+#else 
+	control.begin("/dev/ttyTHS0", B1000000, 166);
+#endif
+
+    for(int servo = 0; servo < SERVOS; servo++)
+    {
+	    control.setEndless(IDs[servo], OFF); // Sets the servos to "Servo" mode
+	    engine.watch(IDs[servo], ON);
+    }
+    
+    engine.start(5*MSEC);
+    
+    for(int i = 0; i < 6; i ++)
+    {
+        for(int servo = 0; servo < SERVOS; servo++)
+            engine.move(IDs[servo], (i % 2) ? 1024 : 3072);
+        
+        for(int print = 0; print < 4; print++)
+        {
+            usleep(SEC/2);
+            for(int servo = 0; servo < SERVOS; servo++)
+                if(engine.readState(IDs[servo], &State) == 0)
+                    cout << "ID " << (int)IDs[servo] << " POSITION: " << State.Position << endl;
+        }
+    }
+    
+    engine.stop();
+    control.disconnect();
+    
+    return 0;
+}
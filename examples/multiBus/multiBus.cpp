@@ -0,0 +1,66 @@
+/*
+    Example for driving Dynamixel MX28-AT series servos split over several buses
+    
+	Serial:
+	GPIO UART: "/dev/ttyTHS0" "/dev/ttyTHS1" "/dev/ttyTHS2"
+	USB  UART: "/dev/ttyUSB0" "/dev/ttyUSB1" ...
+
+    Jetson Pins:
+    gpio57  or 57,    // J3A1 - Pin 50
+	gpio160 or 160,	  // J3A2 - Pin 40	
+	gpio161 or 161,    // J3A2 - Pin 43
+	gpio162 or 162,    // J3A2 - Pin 46
+	gpio163 or 163,    // J3A2 - Pin 49
+	gpio164 or 164,    // J3A2 - Pin 52
+	gpio165 or 165,    // J3A2 - Pin 55
+	gpio166 or 166     // J3A2 - Pin 58
+	
+	*Each bus runs its own engine thread, servos are addressed by ID only
+		manager.addBus(Stream, Baud)		: adds a USB UART bus, returns its index
+		manager.addBus(Stream, Baud, Pin)	: adds a GPIO UART bus, returns its index
+		manager.assign(ID, Bus)				: routes ID to a bus
+		manager.syncMove(IDs, Positions, Count): queues goals on every bus at once
+		manager.readState(ID, &State)		: latest state of ID from its bus
+*/
+
+#include<iostream>
+#include "JetsonMX28BusManager.h"
+
+#define SERVOS 6    // Number of servos over all buses
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+int main()
+{
+    JetsonMX28BusManager manager;
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3, 4, 5, 6};
+    int Positions[SERVOS];
+    MX28State State;
+    
+    int left = manager.addBus("/dev/ttyUSB0", B1000000);
+    int right = manager.addBus("/dev/ttyUSB1", B1000000);
+    
+    for(int servo = 0; servo < SERVOS; servo++)
+        manager.assign(IDs[servo], (servo < SERVOS/2) ? left : right);
+    
+    manager.start(5*MSEC);
+    
+    for(int i = 0; i < 6; i ++)
+    {
+        for(int servo = 0; servo < SERVOS; servo++)
+            Positions[servo] = (i % 2) ? 1024 : 3072;
+        manager.syncMove(IDs, Positions, SERVOS);
+        
+        usleep(2*SEC);
+        for(int servo = 0; servo < SERVOS; servo++)
+            if(manager.readState(IDs[servo], &State) == 0)
+                cout << "ID " << (int)IDs[servo] << " BUS " << manager.route(IDs[servo]) << " POSITION: " << State.Position << endl;
+    }
+    
+    manager.stop();
+    
+    return 0;
+}
@@ -21,6 +21,10 @@
 		Mx28.readVoltage(ID)	: reads the voltage
 		Mx28.readSpeed(ID)		: reads the speed
 		Mx28.readLoad(ID)		: reads the load
+		
+	*Reads every present value of the selected servo with one request
+		Mx28.readState(ID, &State): fills State with position, speed, load,
+		                            voltage, temperature, registered and moving
 */
 
 #include<iostream>
@@ -47,13 +51,19 @@ int main()
     
     control.move(ID, 2048);
     
+    MX28State State;
+    
     for(int i = 0; i < 3; i ++)
     {
-        cout << "POSITION: " << control.readPosition(ID) << endl;
-        cout << "TEMPERATURE: " << control.readTemperature(ID) << endl;
-        cout << "VOLTAGE: " << control.readVoltage(ID) << endl;
-        cout << "SPEED: " << control.readSpeed(ID) << endl;
-        cout << "LOAD: " << control.readLoad(ID) << endl << endl;
+        if(control.readState(ID, &State) == 0)
+        {
+            cout << "POSITION: " << State.Position << endl;
+            cout << "TEMPERATURE: " << State.Temperature << endl;
+            cout << "VOLTAGE: " << State.Voltage << endl;
+            cout << "SPEED: " << State.Speed << endl;
+            cout << "LOAD: " << State.Load << endl;
+            cout << "MOVING: " << State.Moving << endl << endl;
+        }
         usleep(2*SEC);
     }
     
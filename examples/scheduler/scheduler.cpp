@@ -0,0 +1,77 @@
+/*
+    Example for polling servo telemetry at different rates on the Dynamixel MX28-AT series servos
+    
+	Serial:
+	GPIO UART: "/dev/ttyTHS0" "/dev/ttyTHS1" "/dev/ttyTHS2"
+	USB  UART: "/dev/ttyUSB0"
+
+    Jetson Pins:
+    gpio57  or 57,    // J3A1 - Pin 50
+	gpio160 or 160,	  // J3A2 - Pin 40	
+	gpio161 or 161,    // J3A2 - Pin 43
+	gpio162 or 162,    // J3A2 - Pin 46
+	gpio163 or 163,    // J3A2 - Pin 49
+	gpio164 or 164,    // J3A2 - Pin 52
+	gpio165 or 165,    // J3A2 - Pin 55
+	gpio166 or 166     // J3A2 - Pin 58
+	
+	*Reads position at 250 Hz (500 Hz while moving), load at 50 Hz and temperature at 1 Hz
+		poller.add(ID, Address, Length, Rate, Priority, MovingRate): adds a target
+		poller.plan()			: bus load the targets ask for in percent
+		poller.run(Duration)	: polls for Duration micro seconds
+		poller.latest(ID, Address, Length): latest value read
+		poller.report()			: target, planned and achieved rates
+*/
+
+#include<iostream>
+#include "JetsonMX28Scheduler.h"
+
+#define SERVOS 3    // Number of servos on the bus
+#define USB 1   	// 1 for GPIO, 0 for USB
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+int main()
+{
+    JetsonMX28 control;
+    JetsonMX28Scheduler poller(control);
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3};
+
+#if USB
+	control.begin("/dev/ttyUSB0", B1000000);
+#else 
+	control.begin("/dev/ttyTHS0", B1000000, 166);
+#endif
+
+    for(int servo = 0; servo < SERVOS; servo++)
+    {
+        poller.add(IDs[servo], MX_PRESENT_POSITION_L, 2, 250, 2, 500);
+        poller.add(IDs[servo], MX_PRESENT_LOAD_L, 2, 50, 1);
+        poller.add(IDs[servo], MX_PRESENT_TEMPERATURE, 1, 1, 0);
+    }
+    printf("Targets ask for %.1f%% of the bus\n", poller.plan());
+    
+    for(int i = 0; i < 4; i++)
+    {
+        for(int servo = 0; servo < SERVOS; servo++)
+            control.move(IDs[servo], (i % 2) ? 1024 : 3072);
+        
+        poller.run(1*SEC);
+        
+        for(int servo = 0; servo < SERVOS; servo++)
+        {
+            printf("ID %d position %d load %d temperature %d\n", IDs[servo],
+                   poller.latest(IDs[servo], MX_PRESENT_POSITION_L, 2),
+                   poller.latest(IDs[servo], MX_PRESENT_LOAD_L, 2),
+                   poller.latest(IDs[servo], MX_PRESENT_TEMPERATURE, 1));
+        }
+    }
+    
+    poller.report();
+    
+    control.disconnect();
+    return 0;
+}
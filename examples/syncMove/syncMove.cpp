@@ -0,0 +1,79 @@
+/*
+    Example for moving several Dynamixel MX28-AT series servos with one packet
+    
+	Serial:
+	GPIO UART: "/dev/ttyTHS0" "/dev/ttyTHS1" "/dev/ttyTHS2"
+	USB  UART: "/dev/ttyUSB0"
+
+    Jetson Pins:
+    gpio57  or 57,    // J3A1 - Pin 50
+	gpio160 or 160,	  // J3A2 - Pin 40	
+	gpio161 or 161,    // J3A2 - Pin 43
+	gpio162 or 162,    // J3A2 - Pin 46
+	gpio163 or 163,    // J3A2 - Pin 49
+	gpio164 or 164,    // J3A2 - Pin 52
+	gpio165 or 165,    // J3A2 - Pin 55
+	gpio166 or 166     // J3A2 - Pin 58
+	
+	*Moves every servo in the list with a single SYNC_WRITE packet
+		Mx28.syncMove(IDs, Positions, Count):
+		@IDs - array of servo IDs
+		@Positions - goal position for each ID from 0 to 4095
+		@Count - number of servos
+		
+		Mx28.syncMoveSpeed(IDs, Positions, Speeds, Count):
+		@Speeds - speed for each ID from 0 to 1023
+		
+		Mx28.syncWrite(Address, Length, IDs, Data, Count):
+		@Address - first register written on each servo
+		@Length - bytes written on each servo
+		@Data - Length bytes per servo, in the same order as IDs
+*/
+
+#include<iostream>
+#include "JetsonMX28.h"
+
+#define SERVOS 3    // Number of servos on the bus
+#define USB 1   	// 1 for GPIO, 0 for USB
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+int main()
+{
+    JetsonMX28 control;
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3};
+    int Positions[SERVOS];
+    int Speeds[SERVOS];
+
+#if USB
+	control.begin("/dev/ttyUSB0", B1000000);
+#else 
+	control.begin("/dev/ttyTHS0", B1000000, 166);
+#endif
+
+    for(int servo = 0; servo < SERVOS; servo++)
+	    control.setEndless(IDs[servo], OFF); // Sets the servos to "Servo" mode
+    
+    for(int i = 0; i < 3; i ++)
+    {
+        for(int servo = 0; servo < SERVOS; servo++)
+            Positions[servo] = 1024;
+        control.syncMove(IDs, Positions, SERVOS);
+        usleep(2*SEC);
+        
+        for(int servo = 0; servo < SERVOS; servo++)
+        {
+            Positions[servo] = 3072;
+            Speeds[servo] = (servo + 1) * QUARTER_SPEED;
+        }
+        control.syncMoveSpeed(IDs, Positions, Speeds, SERVOS);
+        usleep(2*SEC);
+    }
+    
+    control.disconnect();
+    
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+    Example for starting several Dynamixel MX28-AT series servos at the same instant
+    
+	Serial:
+	GPIO UART: "/dev/ttyTHS0" "/dev/ttyTHS1" "/dev/ttyTHS2"
+	USB  UART: "/dev/ttyUSB0"
+
+    Jetson Pins:
+    gpio57  or 57,    // J3A1 - Pin 50
+	gpio160 or 160,	  // J3A2 - Pin 40	
+	gpio161 or 161,    // J3A2 - Pin 43
+	gpio162 or 162,    // J3A2 - Pin 46
+	gpio163 or 163,    // J3A2 - Pin 49
+	gpio164 or 164,    // J3A2 - Pin 52
+	gpio165 or 165,    // J3A2 - Pin 55
+	gpio166 or 166     // J3A2 - Pin 58
+	
+	*Stages a goal for every servo, checks they all registered it and starts them together
+		motion.stage(ID, Position, Speed): stages a goal position and speed
+		motion.send()			: sends the goals with REG_WRITE
+		motion.verify()			: reads MX_REGISTERED_INSTRUCTION with one BULK_READ
+		motion.commit()			: starts every servo with one ACTION
+		motion.execute()		: send, verify and commit
+		motion.report()			: status of every servo
+*/
+
+#include<iostream>
+#include "JetsonMX28Transaction.h"
+
+#define SERVOS 3    // Number of servos on the bus
+#define USB 1   	// 1 for GPIO, 0 for USB
+#define SEC 1000000 // 1 Second in micro second units for delay
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+int main()
+{
+    JetsonMX28 control;
+    JetsonMX28Transaction motion(control);
+    
+    unsigned char IDs[SERVOS] = {1, 2, 3};
+
+#if USB
+	control.begin("/dev/ttyUSB0", B1000000);
+#else 
+	control.begin("/dev/ttyTHS0", B1000000, 166);
+#endif
+
+    for(int servo = 0; servo < SERVOS; servo++)
+	    control.setEndless(IDs[servo], OFF); // Sets the servos to "Servo" mode
+    
+    for(int i = 0; i < 4; i++)
+    {
+        motion.clear();
+        for(int servo = 0; servo < SERVOS; servo++)
+            motion.stage(IDs[servo], (i % 2) ? 1024 : 3072, 200);
+        
+        if(motion.execute() < 0)
+            motion.report();
+        
+        usleep(2*SEC);
+    }
+    
+    control.disconnect();
+    return 0;
+}
@@ -12,11 +12,27 @@
     MODIFICATIONS:
     2/18/2018 - Created the library with read and write functions
     2/23/2018 - Added the USB UART comptability
-    
-    TODO:
-    - Fix Read functions to packets in order and to avoid faulty packets
-    - Adjust for user input UART and baud rates
-    
+    10/17/2026 - Added SYNC_WRITE for moving several servos with one packet
+    10/17/2026 - Added BULK_READ for reading several servos with one request
+    10/17/2026 - Added readState to read all present values with one request
+    10/17/2026 - Direction pin is kept open, GPIO character device support
+    10/17/2026 - Status packets are decoded in order with checksum and ID checks
+    10/17/2026 - Several buses in one process, see JetsonMX28BusManager
+    10/17/2026 - Latency histograms and bus counters, see stats()
+    10/17/2026 - Virtual servos on a pseudo terminal, see JetsonMX28Emulator
+    10/17/2026 - Response timeouts learned per servo, offline servos fail fast
+    10/17/2026 - Any baud rate through termios2, 2.25/2.5/3 Mbps and switchBaudRate
+    10/17/2026 - USB UART low latency mode and FTDI latency timer
+    10/17/2026 - Writes wait for the status packet only when the return level sends one
+    10/17/2026 - Compile time register map with read<Reg>/write<Reg>, needs C++11
+    10/17/2026 - Packets are built in place in a TX arena, reserve()/commit()/flush()
+    10/17/2026 - beginBatch()/endBatch() send many commands with one direction pin toggle
+    10/17/2026 - Shadow control table, writes of values the servo already has are skipped
+    10/17/2026 - Read cache with a freshness time per register, see enableCache()
+    10/17/2026 - Bus time model for planning loop rates, see predictCycle()
+    10/17/2026 - Broadcast group writes and emergencyStop()
+    10/17/2026 - regWrite() for any register range, see JetsonMX28Transaction
+
 ********************************************************************************************
 
 AUTHOR: Bruce Nelson
@@ -90,6 +106,16 @@ ORGANIZATION: Sparta Robotics
 #define MX_ACTION                   5
 #define MX_RESET                    6
 #define MX_SYNC_WRITE               131
+#define MX_BULK_READ                146
+
+	// Status Error Bits //////////////////////////////////////////////////////////
+#define MX_ERROR_VOLTAGE            1
+#define MX_ERROR_ANGLE              2
+#define MX_ERROR_OVERHEATING        4
+#define MX_ERROR_RANGE              8
+#define MX_ERROR_CHECKSUM           16
+#define MX_ERROR_OVERLOAD           32
+#define MX_ERROR_INSTRUCTION        64
 
 	// Specials ///////////////////////////////////////////////////////////////
 #define OFF                         0
@@ -124,6 +150,26 @@ ORGANIZATION: Sparta Robotics
 #define MX_SPEED_LENGTH             5
 #define MX_GOAL_LENGTH              5
 #define MX_GOAL_SP_LENGTH           7
+#define MX_SYNC_WRITE_LENGTH        4
+#define MX_BULK_READ_LENGTH         3
+#define MX_MAX_BULK                 84
+#define MX_TABLE_SIZE               50
+#define MX_STATUS_LENGTH            6
+#define MX_READ_LENGTH              4
+#define MX_STATE_LENGTH             11
+#define MX_MAX_PACKET_LENGTH        255
+#define MX_BUFFER_SIZE              260
+#define MX_RX_BUFFER_SIZE           1024
+#define MX_TX_ARENA_SIZE            4096        // Queued instruction packets, sent with one write()
+#define MX_PACKET_OVERHEAD          6           // FF FF ID LENGTH INSTRUCTION ... CHECKSUM
+#define MX_WRITE_OVERHEAD           7           // A WRITE_DATA packet also carries the address
+#define MX_CACHE_NEVER              -1          // Always read from the servo
+#define MX_CACHE_UNTIL_WRITTEN      0           // Kept until the library writes it
+#define MX_TEMPERATURE_TTL          1000000     // Micro seconds a cached temperature is served
+#define MX_VOLTAGE_TTL              250000      // Micro seconds a cached voltage is served
+#define MX_HOST_OVERHEAD            60          // Micro seconds of syscalls and wake-ups per transaction
+#define MX_FACTORY_RDT              500         // Return delay of a new servo in micro seconds
+#define MX_MAX_SERVOS               254
 #define MX_ACTION_CHECKSUM			250
 #define BROADCAST_ID                254
 #define MX_START                    255
@@ -132,7 +178,12 @@ ORGANIZATION: Sparta Robotics
 #define MX_CCW_AL_L                 255 
 #define MX_CCW_AL_H                 15
 #define TIME_OUT                    10         
-#define TX_DELAY_TIME				400
+#define RX_TIMEOUT                  (TIME_OUT * 1000)
+#define MX_BITS_PER_BYTE            10
+#define MX_TIMEOUT_SAMPLES          16          // Replies between two timeout updates
+#define MX_TIMEOUT_MARGIN           200         // Micro seconds over the p99 response time
+#define MX_OFFLINE_MISSES           3           // Timeouts in a row before a servo is offline
+#define MX_OFFLINE_RETRY            100000      // Micro seconds before an offline servo is asked again
 #define Tx_MODE                     1
 #define Rx_MODE                     0
 #define LOCK                        1
@@ -143,8 +194,27 @@ ORGANIZATION: Sparta Robotics
 #define QUARTER_SPEED				256
 #define STOP						0
 
-#define TRANSMIT_ON(STATUS) if ((STATUS)) gpioSetValue(data, on)
-#define TRANSMIT_OFF(STATUS) if ((STATUS)) gpioSetValue(data,off)
+#define MX_BOTHER                   0010000     // Baud rate in c_ospeed, from <asm/termbits.h>
+#define MX_IBSHIFT                  16          // Shift of the input baud rate bits in c_cflag
+#define MX_KERNEL_NCCS              19
+#define MX_BAUD_TOLERANCE           3           // Percent a servo accepts between baud rates
+#define MX_BAUD_SETTLE              2000        // Micro seconds for a servo to change its baud rate
+
+#define MX_USB_LATENCY              1           // FTDI latency timer in milli seconds, the driver default is 16
+#define MX_LATENCY_PATH             "/sys/bus/usb-serial/devices/%s/latency_timer"
+
+	// Register Map ///////////////////////////////////////////////////////////
+#define MX_EEPROM                   0
+#define MX_RAM                      1
+#define MX_READ_ONLY                0
+#define MX_READ_WRITE               1
+
+#define GPIO_SYSFS                  0
+#define GPIO_LINE                   1
+#define GPIO_SYSFS_PATH             2           // The value file could not be kept open, it is opened every toggle
+
+#define TRANSMIT_ON(STATUS) if ((STATUS)) setDirection(Tx_MODE)
+#define TRANSMIT_OFF(STATUS) if ((STATUS)) setDirection(Rx_MODE)
 
 #include <iostream>
 #include <stdio.h>
@@ -154,45 +224,307 @@ ORGANIZATION: Sparta Robotics
 #include "jetsonGPIO.h" // Used for GPIO
 #include <inttypes.h>   // Types
 #include <sys/ioctl.h>  // UART Read
+#include <linux/serial.h>   // USB UART low latency
+#include <stdlib.h>
+#include <limits.h>
+#include <poll.h>       // UART Read
+#include <time.h>
 #include <errno.h>
 #include <string.h>
 
+// Kernel struct termios2, <asm/termbits.h> can not be included next to <termios.h>
+struct MX28Termios2 {
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t c_line;
+    cc_t c_cc[MX_KERNEL_NCCS];
+    speed_t c_ispeed;
+    speed_t c_ospeed;
+};
+
+#define MX_TCGETS2                  _IOR('T', 0x2A, struct MX28Termios2)
+#define MX_TCSETS2                  _IOW('T', 0x2B, struct MX28Termios2)
+
+// One servo's register range in a BULK_READ request and the data it returned
+struct MX28BulkEntry {
+    unsigned char ID;
+    unsigned char Address;
+    unsigned char Length;
+    int Error;                          // -1 when the servo did not answer
+    bool Asked;                         // False when left out of the request, level 0 or offline
+    unsigned char Data[MX_TABLE_SIZE];
+};
+
+// Present state of a servo, registers MX_PRESENT_POSITION_L to MX_MOVING
+struct MX28State {
+    int Position;
+    int Speed;
+    int Load;
+    int Voltage;
+    int Temperature;
+    int Registered;
+    int Moving;
+};
+
+	// Statistics ////////////////////////////////////////////////////////////
+#define MX_HIST_SUB_BUCKETS         8           // Buckets per power of 2, about 12% resolution
+#define MX_HIST_BUCKETS             184         // Covers up to 2^25 micro seconds
+#define MX_PHASE_TX                 0           // write() until the UART has sent the packet
+#define MX_PHASE_TURNAROUND         1           // Until the direction pin is back in RX mode
+#define MX_PHASE_RX_WAIT            2           // Waiting for status packet bytes
+#define MX_PHASE_DECODE             3           // Decoding status packets
+#define MX_PHASES                   4
+#define MX_PHASE_RESPONSE           4           // End of request to status packet decoded, per servo only
+#define MX_SERVO_PHASES             5
+#define MX_STAT_INSTRUCTIONS        8           // PING..RESET, SYNC_WRITE, BULK_READ
+
+// Log-linear latency histogram in micro seconds
+struct MX28Histogram {
+    unsigned int Buckets[MX_HIST_BUCKETS];
+    unsigned int Count;
+    long long Sum;
+    long Max;
+    
+    void record(long Value);
+    long percentile(double Percentile) const;
+    long mean() const;
+    void reset();
+};
+
+struct MX28Stats {
+    MX28Histogram Phase[MX_STAT_INSTRUCTIONS][MX_PHASES];
+    MX28Histogram Servo[MX_MAX_SERVOS][MX_SERVO_PHASES];    // Phases of requests to each servo and its response time
+    
+    long long TxPackets;
+    long long TxBytes;
+    long long TxErrors;
+    long long RxPackets;
+    long long RxBytes;
+    long long Timeouts;
+    long long ChecksumErrors;
+    long long FramingErrors;                    // Bad ID or length after a header
+    long long StalePackets;                     // Valid packets nobody was waiting for
+    long long Retries;
+    long long Skipped;                          // Reads not sent to offline or silent servos
+    long long Suppressed;                       // Writes the shadow control table showed were not needed
+    long long CacheHits;                        // Reads served from the shadow control table
+    long long Since;                            // When counting started, CLOCK_MONOTONIC micro seconds
+};
+
+// Response timing of one servo, see setAdaptiveTimeout()
+struct MX28Link {
+    MX28Histogram Response;                     // Response times the timeout is learned from, kept by resetStats()
+    long Timeout;                               // Learned deadline in micro seconds, 0 until enough replies
+    int Misses;                                 // Timeouts in a row
+    long long Retry;                            // An offline servo is asked again after this time
+};
+
+/*
+    What one control cycle sends, the input of predictCycle(). Counts of 0 leave an
+    operation out, lengths are data bytes per servo.
+*/
+struct MX28Workload {
+    int Reads;                          // READ_DATA requests, e.g. readPosition()
+    int ReadLength;
+    int Writes;                         // WRITE_DATA packets, e.g. move() is 2 bytes, moveSpeed() 4
+    int WriteLength;
+    bool Acknowledged;                  // Writes wait for a status packet (status return level 2)
+    int SyncServos;                     // Servos in SYNC_WRITE, e.g. syncMove() is 2 bytes each
+    int SyncLength;
+    int BulkServos;                     // Servos in BULK_READ, e.g. readState() is MX_STATE_LENGTH bytes each
+    int BulkLength;
+    long ReturnDelay;                   // Micro seconds, -1 for the last value given to setRDT()
+};
+
+// A status packet decoded in place, Params stays valid until the next read
+struct MX28Packet {
+    unsigned char ID;
+    unsigned char Error;
+    unsigned char Length;               // Number of parameters
+    const unsigned char *Params;
+};
+
+/*
+    Compile time description of a register: address, width in bytes, memory area,
+    access and the range of values it accepts
+*/
+template<unsigned char A, unsigned char W, unsigned char M, unsigned char C, int Lo, int Hi>
+struct MX28Register {
+    static constexpr unsigned char Address = A;
+    static constexpr unsigned char Width = W;
+    static constexpr unsigned char Area = M;
+    static constexpr unsigned char Access = C;
+    static constexpr int Min = Lo;
+    static constexpr int Max = Hi;
+};
+
+// Registers of the MX-28 control table, e.g. control.read<MX28Reg::PresentPosition>(ID)
+namespace MX28Reg {
+    typedef MX28Register<MX_MODEL_NUMBER_L,         2, MX_EEPROM, MX_READ_ONLY,  0, 65535> ModelNumber;
+    typedef MX28Register<MX_VERSION,                1, MX_EEPROM, MX_READ_ONLY,  0, 255>   Version;
+    typedef MX28Register<MX_ID,                     1, MX_EEPROM, MX_READ_WRITE, 0, 253>   ID;
+    typedef MX28Register<MX_BAUD_RATE,              1, MX_EEPROM, MX_READ_WRITE, 0, 252>   BaudRate;
+    typedef MX28Register<MX_RETURN_DELAY_TIME,      1, MX_EEPROM, MX_READ_WRITE, 0, 254>   ReturnDelayTime;
+    typedef MX28Register<MX_CW_ANGLE_LIMIT_L,       2, MX_EEPROM, MX_READ_WRITE, 0, 4095>  CWAngleLimit;
+    typedef MX28Register<MX_CCW_ANGLE_LIMIT_L,      2, MX_EEPROM, MX_READ_WRITE, 0, 4095>  CCWAngleLimit;
+    typedef MX28Register<MX_LIMIT_TEMPERATURE,      1, MX_EEPROM, MX_READ_WRITE, 0, 99>    LimitTemperature;
+    typedef MX28Register<MX_DOWN_LIMIT_VOLTAGE,     1, MX_EEPROM, MX_READ_WRITE, 50, 160>  DownLimitVoltage;
+    typedef MX28Register<MX_UP_LIMIT_VOLTAGE,       1, MX_EEPROM, MX_READ_WRITE, 50, 160>  UpLimitVoltage;
+    typedef MX28Register<MX_MAX_TORQUE_L,           2, MX_EEPROM, MX_READ_WRITE, 0, 1023>  MaxTorque;
+    typedef MX28Register<MX_RETURN_LEVEL,           1, MX_EEPROM, MX_READ_WRITE, 0, 2>     ReturnLevel;
+    typedef MX28Register<MX_ALARM_LED,              1, MX_EEPROM, MX_READ_WRITE, 0, 127>   AlarmLED;
+    typedef MX28Register<MX_ALARM_SHUTDOWN,         1, MX_EEPROM, MX_READ_WRITE, 0, 127>   AlarmShutdown;
+    typedef MX28Register<MX_DOWN_CALIBRATION_L,     2, MX_EEPROM, MX_READ_ONLY,  0, 65535> DownCalibration;
+    typedef MX28Register<MX_UP_CALIBRATION_L,       2, MX_EEPROM, MX_READ_ONLY,  0, 65535> UpCalibration;
+    
+    typedef MX28Register<MX_TORQUE_ENABLE,          1, MX_RAM, MX_READ_WRITE, 0, 1>        TorqueEnable;
+    typedef MX28Register<MX_LED,                    1, MX_RAM, MX_READ_WRITE, 0, 1>        LED;
+    typedef MX28Register<MX_CW_COMPLIANCE_MARGIN,   1, MX_RAM, MX_READ_WRITE, 0, 254>      CWComplianceMargin;
+    typedef MX28Register<MX_CCW_COMPLIANCE_MARGIN,  1, MX_RAM, MX_READ_WRITE, 0, 254>      CCWComplianceMargin;
+    typedef MX28Register<MX_CW_COMPLIANCE_SLOPE,    1, MX_RAM, MX_READ_WRITE, 0, 254>      CWComplianceSlope;
+    typedef MX28Register<MX_CCW_COMPLIANCE_SLOPE,   1, MX_RAM, MX_READ_WRITE, 0, 254>      CCWComplianceSlope;
+    typedef MX28Register<MX_GOAL_POSITION_L,        2, MX_RAM, MX_READ_WRITE, 0, 4095>     GoalPosition;
+    typedef MX28Register<MX_GOAL_SPEED_L,           2, MX_RAM, MX_READ_WRITE, 0, 2047>     GoalSpeed;
+    typedef MX28Register<MX_TORQUE_LIMIT_L,         2, MX_RAM, MX_READ_WRITE, 0, 1023>     TorqueLimit;
+    typedef MX28Register<MX_PRESENT_POSITION_L,     2, MX_RAM, MX_READ_ONLY,  0, 4095>     PresentPosition;
+    typedef MX28Register<MX_PRESENT_SPEED_L,        2, MX_RAM, MX_READ_ONLY,  0, 2047>     PresentSpeed;
+    typedef MX28Register<MX_PRESENT_LOAD_L,         2, MX_RAM, MX_READ_ONLY,  0, 2047>     PresentLoad;
+    typedef MX28Register<MX_PRESENT_VOLTAGE,        1, MX_RAM, MX_READ_ONLY,  0, 255>      PresentVoltage;
+    typedef MX28Register<MX_PRESENT_TEMPERATURE,    1, MX_RAM, MX_READ_ONLY,  0, 255>      PresentTemperature;
+    typedef MX28Register<MX_REGISTERED_INSTRUCTION, 1, MX_RAM, MX_READ_ONLY,  0, 1>        RegisteredInstruction;
+    typedef MX28Register<MX_PAUSE_TIME,             1, MX_RAM, MX_READ_ONLY,  0, 255>      PauseTime;
+    typedef MX28Register<MX_MOVING,                 1, MX_RAM, MX_READ_ONLY,  0, 1>        Moving;
+    typedef MX28Register<MX_LOCK,                   1, MX_RAM, MX_READ_WRITE, 0, 1>        Lock;
+    typedef MX28Register<MX_PUNCH_L,                2, MX_RAM, MX_READ_WRITE, 0, 1023>     Punch;
+}
+
+// Registers First to Last as one contiguous range
+template<class First, class Last>
+struct MX28Range {
+    static_assert(Last::Address >= First::Address, "register range must go up");
+    static constexpr unsigned char Address = First::Address;
+    static constexpr unsigned char Length = Last::Address + Last::Width - First::Address;
+};
+
+// Instruction packet writing Length bytes from Address, the ID is added at run time
+template<unsigned char Instruction, unsigned char Address, unsigned char Length>
+struct MX28Layout {
+    static constexpr unsigned char LengthByte = Length + 3;         // Instruction, address, data, checksum
+    static constexpr int PacketLength = Length + 7;
+    static constexpr unsigned char Sum = (LengthByte + Instruction + Address) & 0xFF;
+};
+
+/*
+    One JetsonMX28 drives one bus. Instances share no state, so several buses can be
+    driven in parallel from different threads as long as each instance is only used
+    by one thread at a time (see JetsonMX28BusManager).
+*/
 class JetsonMX28 {
 private:
 
-    struct termios options;
-    
 	jetsonGPIO data;
-	unsigned char tx_buffer[14];
-	unsigned char rx_buffer[8];
-    
-	unsigned char Checksum; 
-	unsigned char Direction_Pin;
-	unsigned char Time_Counter;
-	unsigned char Incoming_Byte;               
-	unsigned char Position_High_Byte;
-	unsigned char Position_Low_Byte;
-	unsigned char Speed_High_Byte;
-	unsigned char Speed_Low_Byte;
-	unsigned char Load_High_Byte;
-	unsigned char Load_Low_Byte;
+	unsigned char tx_arena[MX_TX_ARENA_SIZE];
+	unsigned char rx_buffer[MX_RX_BUFFER_SIZE];
+	
+	int tx_used;                        // Bytes queued in tx_arena
+	int tx_last;                        // Offset of the last queued packet
+	int tx_packets;
+	int tx_replies;                     // Queued packets the servos will answer
+	int tx_reserved;                    // Parameter bytes of the open reservation, -1 if none
+	int batching;
 	
+	unsigned char (*shadow)[MX_TABLE_SIZE];                 // Last known control table of each servo
+	unsigned long long shadow_valid[MX_MAX_SERVOS];         // Bit per address, set when shadow holds it
+	unsigned long long shadow_dirty[MX_MAX_SERVOS];         // Bit per address, written in a batch and not sent
+	long long (*shadow_time)[MX_TABLE_SIZE];                // When each byte was last read or written
+	int shadow_enabled;
+	long cache_time[MX_TABLE_SIZE];                         // Freshness of each address, see setCacheTime()
+	int cache_enabled;
+	int position_deadband;
+	int speed_deadband;
+
 	int uart0_filestream;
 	int gpio_status;
+	int gpio_backend;
+	int gpio_fd;
+	long baud_rate;
+	long turnaround_guard;
+	long last_turnaround;
 	int count;
-	int Read_Byte;
-	int Moving_Byte;
-	int RWS_Byte;
-	int Speed_Byte;
-	int Load_Byte;
-	int Position_Byte;
-	int Temperature_Byte;
-	int Voltage_Byte;
-	int Error_Byte; 
+	
+	int rx_head;
+	int rx_scan;
+	int rx_tail;
+	int rx_state;
+	int rx_stale;
+	
+	MX28BulkEntry bulk[MX_MAX_BULK];
+	int bulk_count;
+	
+	MX28Stats *statistics;
+	int stats_enabled;
+	int read_retries;
+	int last_instruction;
+	int last_servo;                     // ID of the last packet sent, the phases of requests to it are kept per servo
+	long long rx_reference;
+	
+	MX28Link *links;
+	int adaptive_timeout;
+	long timeout_margin;
+	long offline_retry;
+	
+	unsigned char return_level[MX_MAX_SERVOS];
+	
+	char uart_path[64];
+	long usb_latency;
+	long return_delay;                  // Last return delay set with setRDT(), for the bus model
+	long host_overhead;
+	
+	long transactionTime(int TxBytes, int Replies, int ReplyLength, long ReturnDelay);
+
+	int openGPIOUART(const char *stream, speed_t baud);
+	void setDirection(int Mode);
+	void queue(int Length);
+	unsigned char *reserveSync(unsigned char Address, unsigned char Length, int Count);
+	int transmit();
+	int command();
+	bool answers(unsigned char ID, unsigned char Instruction);
+	int fill(long long Deadline);
+	void discardInput();
+	int decode(MX28Packet *Packet);
+	void resync();
+	int readPacket(unsigned char ID, int Length, MX28Packet *Packet);
+	int readData(unsigned char ID, unsigned char Address, int Length, MX28Packet *Packet, bool Cache = true);
+	int readValue(unsigned char ID, unsigned char Address, int Length, bool Cache = true);
+	void recordRead(unsigned char ID, long Waiting, long Decoding, long Response);
+	bool available(unsigned char ID);
+	int setLineBaud(long Baud);
+	int latencyPath(char *Path, int Size);
+	void missed(unsigned char ID);
+	bool shadowWrite(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length);
+	int checkRange(unsigned char Address, const unsigned char *Data, int Length);
+	void deadband(unsigned char ID, unsigned char Address, unsigned char *Data, int Length, unsigned char Register, int Band);
+	void track(const unsigned char *Packet);
+	void learn(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length);
+	void forget(unsigned char ID, unsigned char Address, int Length);
+	bool cached(unsigned char ID, unsigned char Address, int Length);
+
+	template<unsigned char Instruction, unsigned char Address, unsigned char Length>
+	int sendRegisters(unsigned char ID, const unsigned char *Data);
+	template<unsigned char Instruction>
+	int sendInstruction(unsigned char ID);
 
 public:
-    void begin(const char *stream, speed_t baud, jetsonGPIO dataPin);
-    void begin(const char *stream, speed_t baud);
+    JetsonMX28();
+    ~JetsonMX28();
+    JetsonMX28(const JetsonMX28 &) = delete;
+    JetsonMX28 &operator=(const JetsonMX28 &) = delete;
+    
+    int begin(const char *stream, speed_t baud, jetsonGPIO dataPin);
+    int begin(const char *stream, speed_t baud);
+    int begin(const char *stream, speed_t baud, const char *gpioChip, unsigned int line);
     void disconnect();
     
     int reset(unsigned char ID);
@@ -209,17 +541,34 @@ public:
 	int turn(unsigned char ID, bool SIDE, int Speed);
 	int moveRW(unsigned char ID, int Position);
 	int moveSpeedRW(unsigned char ID, int Position, int Speed);
-	
+	int regWrite(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length);
+
 	void action(void);
+	
+	int syncWrite(unsigned char Address, unsigned char Length, const unsigned char *IDs, const unsigned char *Data, int Count);
+	int syncMove(const unsigned char *IDs, const int *Positions, int Count);
+	int syncMoveSpeed(const unsigned char *IDs, const int *Positions, const int *Speeds, int Count);
+	int syncTorqueLimit(const unsigned char *IDs, const int *Limits, int Count);
     
 	int torqueStatus(unsigned char ID, bool Status);
 	int ledStatus(unsigned char ID, bool Status);
+	
+	int writeAll(unsigned char Address, const unsigned char *Data, int Length);
+	int torqueAll(bool Status);
+	int ledAll(bool Status);
+	int torqueLimitAll(int Limit);
+	int emergencyStop();
 
 	int readTemperature(unsigned char ID);
 	int readVoltage(unsigned char ID);
 	int readPosition(unsigned char ID);
 	int readSpeed(unsigned char ID);
 	int readLoad(unsigned char ID);
+	int readState(unsigned char ID, MX28State *State);
+	
+	int bulkRead(const unsigned char *IDs, const unsigned char *Addresses, const unsigned char *Lengths, int Count);
+	int bulkReadData(unsigned char ID, unsigned char Address, unsigned char Length);
+	int bulkReadState(unsigned char ID, MX28State *State);
 	
 	int setTempLimit(unsigned char ID, unsigned char Temperature);
 	int setAngleLimit(unsigned char ID, int CWLimit, int CCWLimit);
@@ -238,8 +587,176 @@ public:
 	int RWStatus(unsigned char ID);
 	
     int bytesToRead();
+    long wireTime(int Bytes);
+    void setTurnaroundGuard(long Guard);
+    long turnaroundTime();
+    
+    void setRetries(int Retries);
+    void enableStats(bool Status);
+    const MX28Stats &stats();
+    void resetStats();
+    void printStats(FILE *Output = stdout);
+    
+    void setAdaptiveTimeout(bool Status, long Margin = MX_TIMEOUT_MARGIN);
+    void setOfflineRetry(long Period);
+    long responseTimeout(unsigned char ID);
+    bool online(unsigned char ID);
+    void resetTimeouts();
+    
+    int setBaudRate(long Baud);
+    long baudRate();
+    int switchBaudRate(const unsigned char *IDs, int Count, long Baud);
+    
+    int setUSBLatency(int Milliseconds);
+    long usbLatency();
+
+    int returnLevel(unsigned char ID);
+    int readSRL(unsigned char ID);
+    
+    unsigned char *reserve(int Params);
+    int commit(unsigned char ID, unsigned char Instruction, int Params);
+    int flush();
+    int queued();
+    void beginBatch();
+    int endBatch();
+    
+    void enableShadow(bool Status);
+    void setDeadband(int Position, int Speed);
+    int refresh(unsigned char ID);
+    void invalidate(unsigned char ID);
+    int writeDirty();
+    
+    void enableCache(bool Status);
+    void setCacheTime(unsigned char Address, int Length, long Time);
+    
+    long predictCycle(const MX28Workload &Load);
+    double predictLoad(const MX28Workload &Load, double Rate);
+    double maxRate(const MX28Workload &Load);
+    void setHostOverhead(long Overhead);
+    double busLoad();
+
+    template<class Reg> int read(unsigned char ID);
+    template<class Reg> int write(unsigned char ID, int Value);
+    template<class First, class Last> int readRange(unsigned char ID, unsigned char *Data);
+    template<class First, class Last> int writeRange(unsigned char ID, const unsigned char *Data);
 };
 
-extern JetsonMX28 Mx28;
+/*
+    Builds and sends an instruction packet, the layout and all but the ID and data
+    part of the checksum are compile time constants. A WRITE_DATA the shadow control
+    table shows is not needed is skipped.
+*/
+template<unsigned char Instruction, unsigned char Address, unsigned char Length>
+inline int JetsonMX28::sendRegisters(unsigned char ID, const unsigned char *Data)
+{
+    typedef MX28Layout<Instruction, Address, Length> Layout;
+    unsigned char Sum = Layout::Sum + ID;
+    
+    if( (Instruction == MX_WRITE_DATA) && !shadowWrite(ID, Address, Data, Length) )
+        return 0;
+
+    unsigned char *Packet = reserve(Length + 1) - 5;
+    Packet[0] = MX_START;
+    Packet[1] = MX_START;
+    Packet[2] = ID;
+    Packet[3] = Layout::LengthByte;
+    Packet[4] = Instruction;
+    Packet[5] = Address;
+    for(int i = 0; i < Length; i++)
+    {
+        Packet[6 + i] = Data[i];
+        Sum += Data[i];
+    }
+    Packet[6 + Length] = ~Sum;
+    queue(Layout::PacketLength);
+    
+    return command();
+}
+
+// Instruction packet without parameters: PING, ACTION and RESET
+template<unsigned char Instruction>
+inline int JetsonMX28::sendInstruction(unsigned char ID)
+{
+    unsigned char *Packet = reserve(0) - 5;
+    Packet[0] = MX_START;
+    Packet[1] = MX_START;
+    Packet[2] = ID;
+    Packet[3] = 2;
+    Packet[4] = Instruction;
+    Packet[5] = ~(ID + 2 + Instruction);
+    queue(MX_PACKET_OVERHEAD);
+    
+    return command();
+}
+
+/*
+    Reads a register
+    Returns its value, -1 if nothing was read or the negative error byte
+*/
+template<class Reg>
+inline int JetsonMX28::read(unsigned char ID)
+{
+    return readValue(ID, Reg::Address, Reg::Width);
+}
+
+/*
+    Writes a register, a value out of its range is not sent
+    Returns 0, -1 if an expected status packet did not arrive or the negative error byte
+*/
+template<class Reg>
+inline int JetsonMX28::write(unsigned char ID, int Value)
+{
+    static_assert(Reg::Access == MX_READ_WRITE, "register is read only");
+    
+    if( (Value < Reg::Min) | (Value > Reg::Max) )
+    {
+        printf("RANGE error: %d is not in %d to %d\n", Value, Reg::Min, Reg::Max);
+        return -MX_ERROR_RANGE;
+    }
+    
+    unsigned char Data[2];
+    Data[0] = Value;
+    Data[1] = Value >> 8;
+    
+    return sendRegisters<MX_WRITE_DATA, Reg::Address, Reg::Width>(ID, Data);
+}
+
+/*
+    Reads the registers First to Last with one request
+    @Data - MX28Range<First, Last>::Length bytes
+    Returns 0, -1 if nothing was read or the negative error byte
+*/
+template<class First, class Last>
+inline int JetsonMX28::readRange(unsigned char ID, unsigned char *Data)
+{
+    typedef MX28Range<First, Last> Range;
+    MX28Packet Packet;
+    
+    int Error = readData(ID, Range::Address, Range::Length, &Packet);
+    if(Error < 0)
+        return -1;
+    if(Error != 0)
+        return Error * (-1);
+    
+    memcpy(Data, Packet.Params, Range::Length);
+    return 0;
+}
+
+/*
+    Writes the registers First to Last with one packet, nothing is sent if a value is
+    out of its register's range
+    @Data - MX28Range<First, Last>::Length bytes, low byte first
+    Returns 0, -1 if an expected status packet did not arrive or the negative error byte
+*/
+template<class First, class Last>
+inline int JetsonMX28::writeRange(unsigned char ID, const unsigned char *Data)
+{
+    typedef MX28Range<First, Last> Range;
+    
+    if(checkRange(Range::Address, Data, Range::Length) < 0)
+        return -MX_ERROR_RANGE;
+    
+    return sendRegisters<MX_WRITE_DATA, Range::Address, Range::Length>(ID, Data);
+}
 
 #endif
@@ -0,0 +1,70 @@
+/*
+********************************************************************************************
+    Multi-bus manager for the JetsonMX28 library
+    
+    Drives several UARTs ("/dev/ttyTHS0", "/dev/ttyTHS1", "/dev/ttyUSB0", ...) at once.
+    Every bus gets its own JetsonMX28 and JetsonMX28Engine thread, and a routing table
+    maps each servo ID to the bus it is wired to, so callers address servos by ID only.
+    Splitting a chain over N buses lets the N engines run their cycles in parallel.
+    
+    MODIFICATIONS:
+    10/17/2026 - Created the bus manager
+    10/17/2026 - Broadcast writes and emergencyStop() on every bus
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#ifndef JetsonMX28BusManager_h
+#define JetsonMX28BusManager_h
+
+#include "JetsonMX28Engine.h"
+
+#define MX_MAX_BUSES                8
+#define MX_NO_BUS                   -1
+
+class JetsonMX28BusManager {
+private:
+
+    JetsonMX28 *buses[MX_MAX_BUSES];
+    JetsonMX28Engine *engines[MX_MAX_BUSES];
+    int bus_count;
+    int routes[MX_MAX_SERVOS];
+    
+    int add(JetsonMX28 *Bus);
+
+public:
+    JetsonMX28BusManager();
+    ~JetsonMX28BusManager();
+    
+    int addBus(const char *stream, speed_t baud);
+    int addBus(const char *stream, speed_t baud, jetsonGPIO dataPin);
+    int addBus(const char *stream, speed_t baud, const char *gpioChip, unsigned int line);
+    
+    int assign(unsigned char ID, int Bus);
+    int route(unsigned char ID);
+    
+    int start(long Period = MX_ENGINE_PERIOD);
+    void stop();
+    
+    int write(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length);
+    int move(unsigned char ID, int Position);
+    int moveSpeed(unsigned char ID, int Position, int Speed);
+    int torqueStatus(unsigned char ID, bool Status);
+    int syncMove(const unsigned char *IDs, const int *Positions, int Count);
+    int syncMoveSpeed(const unsigned char *IDs, const int *Positions, const int *Speeds, int Count);
+    
+    int writeAll(unsigned char Address, const unsigned char *Data, int Length);
+    int torqueAll(bool Status);
+    int emergencyStop();
+
+    int readState(unsigned char ID, MX28State *State, long long *Stamp = NULL);
+    
+    JetsonMX28 *bus(int Bus);
+    JetsonMX28Engine *engine(int Bus);
+    int busCount();
+};
+
+#endif
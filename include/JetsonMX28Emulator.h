@@ -0,0 +1,136 @@
+/*
+********************************************************************************************
+    Virtual MX-28 servos for the JetsonMX28 library
+
+    Opens a pseudo terminal and answers Protocol 1.0 instruction packets for a set of
+    virtual servos, so the library can be tested and benchmarked without hardware.
+    Point JetsonMX28::begin() at path() with the USB UART begin:
+
+        JetsonMX28Emulator emulator;
+        emulator.begin(4);              // IDs 1 to 4
+        emulator.start();
+
+        JetsonMX28 bus;
+        bus.begin(emulator.path(), B1000000);
+
+    Every servo has its own control table (addresses 0 to 49) and follows:
+    - the return delay time and status return level registers
+    - the wire time of the instruction and status packets at the line baud rate
+    - the baud rate register, servos on another baud rate than the line stay silent
+    - REG_WRITE/ACTION, SYNC_WRITE, BULK_READ and RESET
+    - a simple motion model moving the present position to the goal position
+
+    Faults can be injected with setFaults() and servos taken off the bus with setOnline().
+    Status packets wait in an outbox until their time on the wire has passed, so a late
+    reply does not hold up the other servos.
+
+    MODIFICATIONS:
+    10/17/2026 - Created the emulator
+    10/17/2026 - Status packets are sent from an outbox instead of sleeping per reply
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#ifndef JetsonMX28Emulator_h
+#define JetsonMX28Emulator_h
+
+#include "JetsonMX28.h"
+#include <atomic>
+#include <thread>
+
+#define MX_EMULATOR_BUFFER          1024
+#define MX_MODEL_NUMBER             29
+#define MX_EMULATOR_SPEED           3755        // Position steps per second at full speed, 55 rpm
+#define MX_SPEED_STEPS              7.78        // Position steps per second per goal speed unit
+#define MX_EMULATOR_REPLIES         64          // Status packets waiting for their send time
+
+// Probabilities (0 to 1) of a fault on each status packet sent
+struct MX28Faults {
+    double NoReply;                     // The whole status packet is lost
+    double DropByte;                    // One byte of the status packet is lost
+    double BadChecksum;                 // The checksum byte is corrupted
+    double LateReply;                   // The status packet is sent LateDelay later
+    long LateDelay;                     // Micro seconds
+};
+
+// A status packet written once it has fully arrived over the wire
+struct MX28PendingReply {
+    long long Due;
+    int Length;
+    unsigned char Data[MX_STATUS_LENGTH + MX_TABLE_SIZE];
+};
+
+struct MX28VirtualServo {
+    bool Present;
+    bool Online;
+    unsigned char Table[MX_TABLE_SIZE];
+    unsigned char Pending[MX_TABLE_SIZE];       // REG_WRITE data waiting for ACTION
+    int PendingAddress;
+    int PendingLength;
+    double Position;                            // Present position with sub step precision
+};
+
+class JetsonMX28Emulator {
+private:
+    MX28VirtualServo servos[MX_MAX_SERVOS];
+    MX28Faults faults;
+
+    int master_fd;
+    int slave_fd;
+    char slave_path[64];
+
+    unsigned char rx_buffer[MX_EMULATOR_BUFFER];
+    int rx_count;
+    unsigned char tx_buffer[MX_BUFFER_SIZE];
+    MX28PendingReply outbox[MX_EMULATOR_REPLIES];   // By due time, equal times in the order queued
+    int outbox_count;
+
+    long line_baud;                     // Baud rate the client set on the terminal
+    long long bus_free;                 // Time the last status packet left the wire
+    long long last_update;
+    std::atomic<long> packet_count;     // Read by the client thread
+    unsigned int seed;
+
+    std::thread worker;
+    std::atomic<bool> running;
+
+    void reset(unsigned char ID);
+    void update(long long Now);
+    long lineBaud();
+    bool listening(unsigned char ID);
+    long wireTime(int Bytes);
+    double chance();
+
+    int process(long long Received);
+    void execute(unsigned char ID, unsigned char Instruction, const unsigned char *Params, int Length, long long Received);
+    int writeTable(unsigned char *ID, unsigned char Address, const unsigned char *Data, int Length);
+    void reply(unsigned char ID, unsigned char Error, const unsigned char *Params, int Length, long long Ready);
+    bool replies(unsigned char ID, unsigned char Instruction);
+    void queueReply(const unsigned char *Packet, int Length, long long Due);
+    void sendDue(long long Now);
+    void run();
+
+public:
+    JetsonMX28Emulator();
+    ~JetsonMX28Emulator();
+
+    int begin(int Servos, unsigned char FirstID = 1);
+    void disconnect();
+    const char *path();
+
+    int start();
+    void stop();
+    int poll(int Timeout);
+
+    int addServo(unsigned char ID);
+    void setOnline(unsigned char ID, bool Status);
+    void setFaults(const MX28Faults &Faults);
+    void setSeed(unsigned int Seed);
+    unsigned char *table(unsigned char ID);
+    long packets();
+};
+
+#endif
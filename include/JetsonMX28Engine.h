@@ -0,0 +1,126 @@
+/*
+********************************************************************************************
+    Background I/O engine for the JetsonMX28 library
+    
+    Owns one JetsonMX28 bus on a dedicated thread. Application threads queue goal and
+    register writes through a lock-free queue and read the latest telemetry of each
+    watched servo from a seqlock protected snapshot, so they never wait on the UART.
+    
+    Every cycle the engine thread:
+    - drains the command queue and sends the writes as SYNC_WRITE packets, one per
+      register range, keeping only the last value queued for each servo
+    - reads the present state of every watched servo with one BULK_READ
+    - publishes the new states
+    
+    emergencyStop() wakes the engine thread and makes it send a broadcast torque off
+    before anything else. It is not preemptive: the stop waits for the bus transaction
+    in progress, at worst one BULK_READ of MX_MAX_BULK servos including the timeout
+    of a servo that does not answer (up to RX_TIMEOUT).
+    
+    MODIFICATIONS:
+    10/17/2026 - Created the engine
+    10/17/2026 - Broadcast writes and emergencyStop()
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#ifndef JetsonMX28Engine_h
+#define JetsonMX28Engine_h
+
+#include "JetsonMX28.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#define MX_QUEUE_SIZE               256         // Must be a power of 2
+#define MX_MAX_GROUPS               8
+#define MX_COMMAND_DATA             4
+#define MX_ENGINE_PERIOD            5000        // Default cycle in micro seconds
+
+// A register write queued by an application thread
+struct MX28Command {
+    unsigned char ID;
+    unsigned char Address;
+    unsigned char Length;
+    unsigned char Data[MX_COMMAND_DATA];
+};
+
+// Bounded multi-producer single-consumer queue cell
+struct MX28QueueCell {
+    std::atomic<unsigned int> Sequence;
+    MX28Command Command;
+};
+
+// Register writes sent in one SYNC_WRITE
+struct MX28Group {
+    unsigned char Address;
+    unsigned char Length;
+    int Count;
+    unsigned char IDs[MX_MAX_SERVOS];
+    unsigned char Data[MX_MAX_SERVOS * MX_COMMAND_DATA];
+};
+
+// Latest telemetry of one servo, written by the engine thread only
+struct MX28Snapshot {
+    std::atomic<unsigned int> Sequence;         // Odd while the engine is writing
+    std::atomic<int> Values[7];
+    std::atomic<long long> Stamp;
+};
+
+class JetsonMX28Engine {
+private:
+
+    JetsonMX28 &bus;
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<long long> cycle_count;
+    long period;
+    
+    std::atomic<bool> stop_request;             // Set by emergencyStop(), cleared by the engine thread
+    std::mutex wake_lock;
+    std::condition_variable wake;
+
+    MX28QueueCell queue[MX_QUEUE_SIZE];
+    std::atomic<unsigned int> queue_head;       // Next cell producers claim
+    unsigned int queue_tail;                    // Next cell the engine reads
+    
+    MX28Group groups[MX_MAX_GROUPS];
+    
+    MX28Snapshot snapshot[MX_MAX_SERVOS];
+    std::atomic<bool> watched[MX_MAX_SERVOS];
+    
+    int pop(MX28Command *Command);
+    void sendCommands();
+    void sendGroups(int Count);
+    bool overlaps(int Count, const MX28Command &Command);
+    void checkStop();
+    void readTelemetry();
+    void publish(unsigned char ID, const MX28State *State);
+    void run();
+
+public:
+    JetsonMX28Engine(JetsonMX28 &Bus);
+    ~JetsonMX28Engine();
+    
+    int start(long Period = MX_ENGINE_PERIOD);
+    void stop();
+    
+    int watch(unsigned char ID, bool Status);
+    
+    int write(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length);
+    int move(unsigned char ID, int Position);
+    int moveSpeed(unsigned char ID, int Position, int Speed);
+    int torqueStatus(unsigned char ID, bool Status);
+    int writeAll(unsigned char Address, const unsigned char *Data, int Length);
+    int torqueAll(bool Status);
+    int emergencyStop();
+    
+    int readState(unsigned char ID, MX28State *State, long long *Stamp = NULL);
+    long long cycles();
+};
+
+#endif
@@ -0,0 +1,116 @@
+/*
+********************************************************************************************
+    Fixed-rate control loop runner for the JetsonMX28 library
+    
+    Runs a user callback at a fixed period on the calling thread, sleeping with
+    clock_nanosleep(TIMER_ABSTIME) so the period does not drift. Every cycle it
+    reads the state of all servos with one BULK_READ, calls the callback and
+    writes the goals it set with one SYNC_WRITE.
+    
+    Optionally switches the thread to SCHED_FIFO, pins it to a CPU and locks
+    memory with mlockall. Wake-up jitter is kept in a 1 us histogram and overruns
+    (cycles that end after the next wake-up) are counted.
+    
+    Before it starts, the bus time of a cycle is predicted with JetsonMX28::predictCycle()
+    and a period it does not fit in is reported, refused or stretched (setAdmission()).
+    The bus time measured every cycle is kept to compare with the prediction.
+    
+    MODIFICATIONS:
+    10/17/2026 - Created the loop runner
+    10/17/2026 - Admission control against the bus time model
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#ifndef JetsonMX28Loop_h
+#define JetsonMX28Loop_h
+
+#include "JetsonMX28.h"
+
+#define MX_JITTER_BUCKETS           10000       // 1 us buckets, later samples go in the last one
+#define MX_LOOP_PERIOD              2000        // Default period in micro seconds (500 Hz)
+#define MX_ADMIT_LOAD               90          // Percent of the period the bus may be busy
+
+    // Admission modes, see setAdmission()
+#define MX_ADMIT_OFF                0           // Run without checking
+#define MX_ADMIT_WARN               1           // Print a warning and run
+#define MX_ADMIT_REFUSE             2           // Do not run
+#define MX_ADMIT_DEGRADE            3           // Stretch the period until the cycle fits
+
+// Data handed to the callback every cycle
+struct MX28LoopCycle {
+    int Count;
+    const unsigned char *IDs;
+    const MX28State *States;            // Read at the start of this cycle
+    const int *Valid;                   // 1 if the servo answered this cycle
+    int *Positions;                     // Goals written after the callback
+    int *Speeds;                        // Written with the positions when SendSpeed is set
+    int SendSpeed;                      // Starts as setSendSpeed(), the callback may change it
+    long long Cycle;
+    long long Time;                     // Scheduled wake-up, CLOCK_MONOTONIC micro seconds
+};
+
+// Return 0 to keep running, anything else stops the loop
+typedef int (*MX28LoopCallback)(MX28LoopCycle *Cycle, void *User);
+
+class JetsonMX28Loop {
+private:
+
+    JetsonMX28 &bus;
+    
+    unsigned char IDs[MX_MAX_BULK];
+    unsigned char Addresses[MX_MAX_BULK];
+    unsigned char Lengths[MX_MAX_BULK];
+    MX28State States[MX_MAX_BULK];
+    int Valid[MX_MAX_BULK];
+    int Positions[MX_MAX_BULK];
+    int Speeds[MX_MAX_BULK];
+    int servo_count;
+    
+    long period;                        // Period run() uses, stretched by MX_ADMIT_DEGRADE
+    long requested_period;              // Period given to setPeriod()
+    int priority;
+    int cpu;
+    int lock_memory;
+    int send_speed;                     // Cycles send speeds, the admission model counts them
+    
+    long long cycle_count;
+    long long overrun_count;
+    long max_jitter;
+    long jitter[MX_JITTER_BUCKETS];
+    
+    int admission;
+    long model_time;                    // Predicted bus time of a cycle
+    long long bus_time;                 // Measured bus time of all cycles
+    long max_bus_time;
+
+    int setup();
+    int admit();
+
+public:
+    JetsonMX28Loop(JetsonMX28 &Bus);
+    
+    int setServos(const unsigned char *ServoIDs, int Count);
+    void setPeriod(long Period);
+    void setRealtime(int Priority);
+    void setCPU(int CPU);
+    void setLockMemory(bool Status);
+    void setSendSpeed(bool Status);
+    void setAdmission(int Mode);
+
+    int run(MX28LoopCallback Callback, void *User, long long Cycles = 0);
+    
+    long long cycles();
+    long long overruns();
+    long jitterPercentile(double Percentile);
+    long maxJitter();
+    long predictedBusTime();
+    long meanBusTime();
+    void resetStats();
+    void printStats();
+};
+
+#endif
@@ -0,0 +1,107 @@
+/*
+********************************************************************************************
+    Telemetry polling scheduler for the JetsonMX28 library
+
+    Reads register ranges of many servos at their own rates instead of everything at
+    the rate of the fastest one. Every target is a servo, a register range, a rate
+    and a priority, e.g. position at 250 Hz, load at 50 Hz and temperature at 1 Hz:
+
+        JetsonMX28Scheduler poller(control);
+        poller.add(1, MX_PRESENT_POSITION_L, 2, 250, 2);
+        poller.add(1, MX_PRESENT_LOAD_L, 2, 50, 1);
+        poller.add(1, MX_PRESENT_TEMPERATURE, 1, 1, 0);
+        poller.run(10 * 1000000);
+
+    Every tick the targets that are due are combined, one range per servo, into a
+    BULK_READ that fits the share of the tick's bus time, as predicted by the bus model
+    (JetsonMX28::predictCycle()) with the wire time, return delays, turnaround and host
+    overhead. plan() checks the rates against that budget, with moving rates counted
+    as if every servo moved, and lowers the rates of the lowest priorities first, down
+    to MX_POLL_MIN_RATE, when they do not fit. Targets with a moving rate are read at
+    it while the servo's MX_MOVING flag is set. report() compares the rates achieved
+    with the targets.
+
+    MODIFICATIONS:
+    10/17/2026 - Created the scheduler
+    10/17/2026 - Budget in bus time from the bus model, moving rates are planned
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#ifndef JetsonMX28Scheduler_h
+#define JetsonMX28Scheduler_h
+
+#include "JetsonMX28.h"
+
+#define MX_MAX_POLLS                256
+#define MX_POLL_PERIOD              4000        // Scheduler tick in micro seconds (250 Hz)
+#define MX_POLL_LOAD                80          // Percent of the bus time the schedule may use
+#define MX_POLL_MIN_RATE            1.0         // Reads per second every target keeps when the bus is full
+
+// One register range of one servo read at its own rate
+struct MX28PollTarget {
+    unsigned char ID;
+    unsigned char Address;
+    unsigned char Length;
+    int Priority;                       // Higher priorities keep their rate when the bus is full
+    double Rate;                        // Wanted reads per second
+    double MovingRate;                  // Reads per second while the servo moves, 0 for Rate
+    double Scale;                       // Share of the higher rate, up to the tick rate, plan() could fit, 0 to 1
+
+    long long Next;                     // When the next read is due
+    long long Polls;
+    long long Answers;
+    long long Deferred;                 // Ticks it was due but did not fit
+    long long Time;                     // When Data was read, 0 before the first answer
+    unsigned char Data[MX_TABLE_SIZE];
+};
+
+class JetsonMX28Scheduler {
+private:
+
+    JetsonMX28 &bus;
+
+    MX28PollTarget targets[MX_MAX_POLLS];
+    int order[MX_MAX_POLLS];            // Target indexes by priority
+    int target_count;
+
+    int moving[MX_MAX_SERVOS];
+    long period;
+    int load;
+    double demand;                      // Bus micro seconds per second the targets ask for
+
+    long long start_time;
+    long long tick_count;
+    long long busy_time;                // Micro seconds spent in bulk reads
+
+    double rate(const MX28PollTarget &Target);
+    long bulkTime(int Servos, int Length);
+    long cost(int Length);
+    long overhead();
+
+public:
+    JetsonMX28Scheduler(JetsonMX28 &Bus);
+
+    int add(unsigned char ID, unsigned char Address, unsigned char Length, double Rate, int Priority = 0, double MovingRate = 0);
+    void clear();
+    void setPeriod(long Period);
+    void setLoad(int Percent);
+    double plan();
+
+    int poll();
+    int run(long long Duration);
+
+    int latest(unsigned char ID, unsigned char Address, int Length);
+    long long age(int Target);
+    const MX28PollTarget &target(int Target);
+
+    double achievedRate(int Target);
+    double utilisation();
+    void resetStats();
+    void report(FILE *Output = stdout);
+};
+
+#endif
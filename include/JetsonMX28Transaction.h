@@ -0,0 +1,87 @@
+/*
+********************************************************************************************
+    Staged multi-servo transactions for the JetsonMX28 library
+
+    Starts the motion of many servos at the same instant instead of one move() after
+    the other. Goals are staged per servo, sent with REG_WRITE so every servo holds its
+    goal without moving, optionally checked with one BULK_READ of
+    MX_REGISTERED_INSTRUCTION and carried out by all servos at once with one broadcast
+    ACTION:
+
+        JetsonMX28Transaction motion(control);
+        motion.stage(1, 1024);
+        motion.stage(2, 3072, 200);
+        if(motion.execute() < 0)
+            motion.report();
+
+    Every servo keeps a status (MX_STAGE_*), so a transaction that was not committed
+    shows which servo did not register its goal. A servo holds one registered
+    instruction, staging it again replaces its goal. Servos that did register still
+    carry it out at the next ACTION, whoever sends it.
+
+    MODIFICATIONS:
+    10/17/2026 - Created the transactions
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#ifndef JetsonMX28Transaction_h
+#define JetsonMX28Transaction_h
+
+#include "JetsonMX28.h"
+
+#define MX_STAGE_DATA               8           // Most bytes one servo can stage, e.g. goal position to torque limit is 6
+
+    // Status of a servo in a transaction
+#define MX_STAGE_STAGED             0           // Not sent yet
+#define MX_STAGE_SENT               1           // REG_WRITE sent, stays so for servos at status return level 0
+#define MX_STAGE_REGISTERED         2           // The servo reported the registered instruction
+#define MX_STAGE_COMMITTED          3           // ACTION sent
+#define MX_STAGE_FAILED             -1          // The REG_WRITE was not acknowledged or got an error
+#define MX_STAGE_NOT_REGISTERED     -2          // The servo answered without a registered instruction
+#define MX_STAGE_NO_ANSWER          -3          // The servo did not answer the verification
+#define MX_STAGE_NONE               -4          // The servo is not in the transaction
+
+// The registers one servo writes at ACTION
+struct MX28StagedWrite {
+    unsigned char ID;
+    unsigned char Address;
+    unsigned char Length;
+    unsigned char Data[MX_STAGE_DATA];
+    int Status;                         // MX_STAGE_*
+    int Error;                          // REG_WRITE result, 0, -1 or the negative error byte
+};
+
+class JetsonMX28Transaction {
+private:
+
+    JetsonMX28 &bus;
+
+    MX28StagedWrite writes[MX_MAX_SERVOS];
+    int slots[MX_MAX_SERVOS];           // Index in writes of each ID, -1 when not staged
+    int write_count;
+
+public:
+    JetsonMX28Transaction(JetsonMX28 &Bus);
+
+    int stage(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length);
+    int stage(unsigned char ID, int Position);
+    int stage(unsigned char ID, int Position, int Speed);
+    void clear();
+
+    int send();
+    int verify();
+    int commit(bool Force = false);
+    int execute(bool Verify = true);
+
+    int status(unsigned char ID);
+    int failed();
+    int count();
+    const MX28StagedWrite &entry(int Index);
+    void report(FILE *Output = stdout);
+};
+
+#endif
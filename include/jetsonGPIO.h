@@ -84,6 +84,10 @@ int gpioSetEdge ( jetsonGPIO gpio, char *edge ) ;
 int gpioOpen ( jetsonGPIO gpio ) ;
 int gpioClose ( int fileDescriptor ) ;
 int gpioActiveLow ( jetsonGPIO gpio, unsigned int value ) ;
+int gpioOpenValue ( jetsonGPIO gpio ) ;
+int gpioWriteValue ( int fileDescriptor, unsigned int value ) ;
+int gpioLineOpen ( const char *chip, unsigned int line ) ;
+int gpioLineSetValue ( int fileDescriptor, unsigned int value ) ;
 
 
 
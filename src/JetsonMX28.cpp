@@ -14,7 +14,6 @@
     2/23/2018 - Added the USB UART comptability
     
     TODO:
-    - Fix Read functions to packets in order and to avoid faulty packets
     - Fix Read to read data majority of the time
     
 ********************************************************************************************
@@ -26,40 +25,295 @@ ORGANIZATION: Sparta Robotics
 
 #include "JetsonMX28.h"
 
-void JetsonMX28::begin(const char *stream, speed_t baud, jetsonGPIO dataPin)
+// Status packet decoder states
+enum { RX_HEADER_1, RX_HEADER_2, RX_ID, RX_LENGTH, RX_PARAMS };
+
+static long baudValue(speed_t baud)
+{
+    switch(baud)
+    {
+        case B9600:     return 9600;
+        case B19200:    return 19200;
+        case B38400:    return 38400;
+        case B57600:    return 57600;
+        case B115200:   return 115200;
+        case B230400:   return 230400;
+        case B460800:   return 460800;
+        case B500000:   return 500000;
+        case B576000:   return 576000;
+        case B921600:   return 921600;
+        case B1000000:  return 1000000;
+        case B1152000:  return 1152000;
+        case B1500000:  return 1500000;
+        case B2000000:  return 2000000;
+        case B2500000:  return 2500000;
+        case B3000000:  return 3000000;
+        case B3500000:  return 3500000;
+        case B4000000:  return 4000000;
+        default:        return baud;        // Not a B constant, already in bits per second
+    }
+}
+
+// True for B9600 and the like, false for a rate in bits per second like 2250000
+static bool baudConstant(speed_t baud)
+{
+    return baudValue(baud) != (long)baud;
+}
+
+/*
+    Baud rate register value for Baud, -1 if no value is within MX_BAUD_TOLERANCE.
+    Values up to 249 give 2000000/(value + 1), 250 to 252 are 2.25, 2.5 and 3 Mbps.
+*/
+static int baudRegister(long Baud)
+{
+    if(Baud <= 0)
+        return -1;
+    
+    int BD;
+    if(Baud > 2125000)
+        BD = (Baud < 2375000) ? 250 : (Baud < 2750000) ? 251 : 252;
+    else
+        BD = (2000000 + Baud / 2) / Baud - 1;
+    if( (BD < 0) | (BD > 252) )
+        return -1;
+    
+    long Actual = (BD == 250) ? 2250000 : (BD == 251) ? 2500000 : (BD == 252) ? 3000000 : 2000000 / (BD + 1);
+    long Difference = (Actual > Baud) ? Actual - Baud : Baud - Actual;
+    
+    return (Difference * 100 <= Baud * MX_BAUD_TOLERANCE) ? BD : -1;
+}
+
+// Unpacks registers MX_PRESENT_POSITION_L to MX_MOVING
+static void decodeState(const unsigned char *Params, MX28State *State)
+{
+    State->Position    = Params[0] + (Params[1] << 8);
+    State->Speed       = Params[2] + (Params[3] << 8);
+    State->Load        = Params[4] + (Params[5] << 8);
+    State->Voltage     = Params[MX_PRESENT_VOLTAGE - MX_PRESENT_POSITION_L];
+    State->Temperature = Params[MX_PRESENT_TEMPERATURE - MX_PRESENT_POSITION_L];
+    State->Registered  = Params[MX_REGISTERED_INSTRUCTION - MX_PRESENT_POSITION_L];
+    State->Moving      = Params[MX_MOVING - MX_PRESENT_POSITION_L];
+}
+
+// Index of an instruction in MX28Stats::Phase
+static int instructionIndex(int Instruction)
+{
+    switch(Instruction)
+    {
+        case MX_SYNC_WRITE: return 6;
+        case MX_BULK_READ:  return 7;
+        default:            return ((Instruction >= MX_PING) & (Instruction <= MX_RESET)) ? Instruction - 1 : 0;
+    }
+}
+
+static const char *instructionNames[MX_STAT_INSTRUCTIONS] = {
+    "PING", "READ_DATA", "WRITE_DATA", "REG_WRITE", "ACTION", "RESET", "SYNC_WRITE", "BULK_READ"
+};
+
+static const char *phaseNames[MX_SERVO_PHASES] = { "tx", "turnaround", "rx wait", "decode", "response" };
+
+// RAM registers writeDirty() may rewrite with the value the shadow holds
+static bool rewritable(int Address)
+{
+    return ((Address >= MX_TORQUE_ENABLE) & (Address <= MX_TORQUE_LIMIT_H)) | ((Address >= MX_LOCK) & (Address <= MX_PUNCH_H));
+}
+
+// Valid values of a writable register, checked by writeRange()
+struct MX28Limit {
+    unsigned char Address;
+    unsigned char Width;
+    int Min;
+    int Max;
+};
+
+template<class Reg>
+static constexpr MX28Limit limit()
+{
+    return {Reg::Address, Reg::Width, Reg::Min, Reg::Max};
+}
+
+static const MX28Limit writableLimits[] = {
+    limit<MX28Reg::ID>(), limit<MX28Reg::BaudRate>(), limit<MX28Reg::ReturnDelayTime>(),
+    limit<MX28Reg::CWAngleLimit>(), limit<MX28Reg::CCWAngleLimit>(), limit<MX28Reg::LimitTemperature>(),
+    limit<MX28Reg::DownLimitVoltage>(), limit<MX28Reg::UpLimitVoltage>(), limit<MX28Reg::MaxTorque>(),
+    limit<MX28Reg::ReturnLevel>(), limit<MX28Reg::AlarmLED>(), limit<MX28Reg::AlarmShutdown>(),
+    limit<MX28Reg::TorqueEnable>(), limit<MX28Reg::LED>(), limit<MX28Reg::CWComplianceMargin>(),
+    limit<MX28Reg::CCWComplianceMargin>(), limit<MX28Reg::CWComplianceSlope>(), limit<MX28Reg::CCWComplianceSlope>(),
+    limit<MX28Reg::GoalPosition>(), limit<MX28Reg::GoalSpeed>(), limit<MX28Reg::TorqueLimit>(),
+    limit<MX28Reg::Lock>(), limit<MX28Reg::Punch>()
+};
+
+static long long monotonicMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+JetsonMX28::JetsonMX28()
+{
+    uart0_filestream = -1;
+    gpio_status = OFF;
+    gpio_fd = -1;
+    baud_rate = 1000000;
+    turnaround_guard = -1;
+    last_turnaround = 0;
+    bulk_count = 0;
+    
+    rx_head = rx_scan = rx_tail = 0;
+    rx_state = RX_HEADER_1;
+    rx_stale = 0;
+    
+    tx_used = tx_last = tx_packets = tx_replies = 0;
+    tx_reserved = -1;
+    batching = 0;
+    
+    // The per servo tables and histograms are too big for a thread's stack
+    shadow = new unsigned char[MX_MAX_SERVOS][MX_TABLE_SIZE];
+    shadow_time = new long long[MX_MAX_SERVOS][MX_TABLE_SIZE];
+    statistics = new MX28Stats;
+    links = new MX28Link[MX_MAX_SERVOS];
+
+    shadow_enabled = 0;
+    position_deadband = speed_deadband = 0;
+    memset(shadow_valid, 0, sizeof(shadow_valid));
+    memset(shadow_dirty, 0, sizeof(shadow_dirty));
+    
+    // EEPROM only changes when written, the rest is read every time unless set otherwise
+    cache_enabled = 0;
+    for(int address = 0; address < MX_TABLE_SIZE; address++)
+        cache_time[address] = (address <= MX_UP_CALIBRATION_H) ? MX_CACHE_UNTIL_WRITTEN : MX_CACHE_NEVER;
+    cache_time[MX_PRESENT_TEMPERATURE] = MX_TEMPERATURE_TTL;
+    cache_time[MX_PRESENT_VOLTAGE] = MX_VOLTAGE_TTL;
+
+    stats_enabled = 1;
+    read_retries = 0;
+    last_instruction = 0;
+    last_servo = 0;
+    rx_reference = 0;
+    resetStats();
+    
+    adaptive_timeout = 1;
+    timeout_margin = MX_TIMEOUT_MARGIN;
+    offline_retry = MX_OFFLINE_RETRY;
+    resetTimeouts();
+    
+    uart_path[0] = 0;
+    usb_latency = -1;
+    return_delay = MX_FACTORY_RDT;
+    host_overhead = MX_HOST_OVERHEAD;
+
+    // Factory setting, every instruction is answered
+    memset(return_level, 2, sizeof(return_level));
+}
+
+JetsonMX28::~JetsonMX28()
+{
+    delete[] shadow;
+    delete[] shadow_time;
+    delete statistics;
+    delete[] links;
+}
+
+/*
+    Opens the GPIO UART with the direction pin on a sysfs GPIO. When the pin's value
+    file can not be kept open it is written the old way, opening it every toggle.
+    Returns 0, or -1 if the direction pin or the UART could not be opened
+*/
+int JetsonMX28::begin(const char *stream, speed_t baud, jetsonGPIO dataPin)
 {
     // Configure GPIO
     gpio_status = ON;
     data = dataPin;
     gpioExport(data);
     gpioSetDirection(data,outputPin);
+    gpio_backend = GPIO_SYSFS;
+    gpio_fd = gpioOpenValue(data);
+    
+    if(gpio_fd < 0)
+    {
+        if(gpioSetValue(data, low) != 0)
+        {
+            printf("Error - Unable to drive the direction pin gpio%d\n", data);
+            gpio_status = OFF;
+            return -1;
+        }
+        printf("GPIO warning: gpio%d is opened on every direction change\n", data);
+        gpio_backend = GPIO_SYSFS_PATH;
+    }
+    
+    return openGPIOUART(stream, baud);
+}
+
+/*
+    Same as the GPIO UART begin but drives the direction pin through a GPIO
+    character device line, e.g. begin("/dev/ttyTHS0", B1000000, "/dev/gpiochip0", 166)
+    Returns 0, or -1 if the line or the UART could not be opened
+*/
+int JetsonMX28::begin(const char *stream, speed_t baud, const char *gpioChip, unsigned int line)
+{
+    // Configure GPIO
+    gpio_status = ON;
+    gpio_backend = GPIO_LINE;
+    gpio_fd = gpioLineOpen(gpioChip, line);
+    
+    if(gpio_fd < 0)
+    {
+        printf("Error - Unable to drive the direction pin, line %u of %s\n", line, gpioChip);
+        gpio_status = OFF;
+        return -1;
+    }
     
+    return openGPIOUART(stream, baud);
+}
+
+int JetsonMX28::openGPIOUART(const char *stream, speed_t baud)
+{
     // Configure UART
+    baud_rate = baudValue(baud);
+    resetTimeouts();
     uart0_filestream = -1;
-    uart0_filestream = open("/dev/ttyTHS0", O_RDWR | O_NOCTTY | O_NDELAY);		//Open in non blocking read/write mode
+    uart0_filestream = open(stream, O_RDWR | O_NOCTTY | O_NDELAY);		//Open in non blocking read/write mode
 	if (uart0_filestream == -1)
 	{
 		//ERROR - CAN'T OPEN SERIAL PORT
 		printf("Error - Unable to open UART.  Ensure it is not in use by another application\n");
+		return -1;
 	}
-	
+
 	struct termios options;
 	tcgetattr(uart0_filestream, &options);
-	options.c_cflag = baud | CS8 | CLOCAL | CREAD;		//<Set baud rate
+	options.c_cflag = (baudConstant(baud) ? baud : B38400) | CS8 | CLOCAL | CREAD;		//<Set baud rate
 	options.c_iflag = IGNPAR;
 	options.c_oflag = 0;
 	options.c_lflag = 0;
 	tcflush(uart0_filestream, TCIFLUSH);
 	tcsetattr(uart0_filestream, TCSANOW, &options);
+	
+	if(!baudConstant(baud))
+	    setLineBaud(baud);
+	
+	return 0;
 }
 
-void JetsonMX28::begin(const char *stream, speed_t baud)
+/*
+    Opens a USB UART, the adapter switches the direction itself
+    Returns 0 or -1 if the UART could not be opened
+*/
+int JetsonMX28::begin(const char *stream, speed_t baud)
 {
     // Configure GPIO
     gpio_status = OFF;
+    baud_rate = baudValue(baud);
+    resetTimeouts();
     
     uart0_filestream = open(stream, O_RDWR| O_NOCTTY );
-    
+    if(uart0_filestream == -1)
+    {
+        printf("Error - Unable to open UART %s\n", stream);
+        return -1;
+    }
+
     struct termios tty;
     struct termios tty_old;
     memset (&tty, 0, sizeof tty);
@@ -70,8 +324,9 @@ void JetsonMX28::begin(const char *stream, speed_t baud)
 
     tty_old = tty;
 
-    cfsetospeed (&tty, baud);
-    cfsetispeed (&tty, baud);
+    speed_t line = baudConstant(baud) ? baud : B38400;     // Custom rates are set below
+    cfsetospeed (&tty, line);
+    cfsetispeed (&tty, line);
 
     tty.c_cflag     &=  ~PARENB;
     tty.c_cflag     &=  ~CSTOPB;
@@ -89,12 +344,29 @@ void JetsonMX28::begin(const char *stream, speed_t baud)
     if ( tcsetattr ( uart0_filestream, TCSANOW, &tty ) != 0) {
        std::cout << "Error " << errno << " from tcsetattr" << std::endl;
     }
+    
+    if(!baudConstant(baud))
+        setLineBaud(baud);
+    
+    // USB adapters hold status bytes for the latency timer before passing them on
+    strncpy(uart_path, stream, sizeof(uart_path) - 1);
+    uart_path[sizeof(uart_path) - 1] = 0;
+    setUSBLatency(MX_USB_LATENCY);
+    if(usb_latency >= 0)
+        printf("USB UART latency %ld us\n", usb_latency);
+    
+    return 0;
 }
 
 void JetsonMX28::disconnect()
 {
 	if(gpio_status)
-		gpioUnexport(data);
+	{
+		if(gpio_fd >= 0)
+			close(gpio_fd);
+		if(gpio_backend != GPIO_LINE)
+			gpioUnexport(data);
+	}
 		
     close(uart0_filestream);
     printf("DISCONNECTED!!! \n");
@@ -102,181 +374,75 @@ void JetsonMX28::disconnect()
 
 int JetsonMX28::reset(unsigned char ID)
 {
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-
-	Checksum = (~(ID + MX_RESET_LENGTH + MX_RESET))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_RESET_LENGTH;
-    tx_buffer[4] = MX_RESET;
-    tx_buffer[5] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 6);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
+	int Error = sendInstruction<MX_RESET>(ID);
 	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+	// Factory settings, the servo is now ID 1 and answers every instruction. A broadcast
+	// reset leaves every servo on ID 1 at once, nothing can be said about that ID.
+	if(ID < MX_MAX_SERVOS)
+		return_level[1] = 2;
+	invalidate(ID);
+	invalidate(1);
+
+	return Error;
 }
 
+// Returns 0 if ID answered, -1 if it did not or the negative error byte
 int JetsonMX28::ping(unsigned char ID)
 {
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-
-	Checksum = (~(ID + MX_READ_DATA + MX_PING))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_PING;
-    tx_buffer[4] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 5);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+	return sendInstruction<MX_PING>(ID);
 }
 
 int JetsonMX28::setID(unsigned char ID, unsigned char newID)
 {
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-
-	Checksum = (~(ID + MX_ID_LENGTH + MX_WRITE_DATA + MX_ID + newID))&0xFF;
+    int Error = write<MX28Reg::ID>(ID, newID);
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_ID_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_ID;
-    tx_buffer[6] = newID;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    // What the library knows about the servo moves with it
+    if( (Error == 0) & (ID < MX_MAX_SERVOS) & (newID < MX_MAX_SERVOS) )
+    {
+        return_level[newID] = return_level[ID];
+        links[newID] = links[ID];
+        
+        memcpy(shadow[newID], shadow[ID], MX_TABLE_SIZE);
+        shadow_valid[newID] = shadow_valid[ID];
+        shadow_dirty[newID] = shadow_dirty[ID];
+        memcpy(shadow_time[newID], shadow_time[ID], sizeof(shadow_time[ID]));
+        shadow_valid[ID] = shadow_dirty[ID] = 0;
+    }
+    
+    return Error;
 }
 
+/*
+    Sets the baud rate register of ID, only the servo changes, see switchBaudRate()
+    @baud - bits per second, 2000000/(n + 1) or 2250000, 2500000, 3000000
+*/
 int JetsonMX28::setBD(unsigned char ID, long baud)
 {
-    unsigned char Baud_Rate = (2000000/baud) - 1;
-    
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-
-	Checksum = (~(ID + MX_BD_LENGTH + MX_WRITE_DATA + MX_BAUD_RATE + Baud_Rate))&0xFF;
+    int Baud_Rate = baudRegister(baud);
+    if(Baud_Rate < 0)
+    {
+        printf("BAUD RATE error: %ld bps is not a servo baud rate\n", baud);
+        return -1;
+    }
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_BD_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_BAUD_RATE;
-    tx_buffer[6] = Baud_Rate;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return write<MX28Reg::BaudRate>(ID, Baud_Rate);
 }
 
 int JetsonMX28::move(unsigned char ID, int Position)
 {
-    char Position_H,Position_L;
-    
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-   
-    Position_H = Position >> 8;
-    Position_L = Position;
-	Checksum = (~(ID + MX_GOAL_LENGTH + MX_WRITE_DATA + MX_GOAL_POSITION_L + Position_L + Position_H))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_GOAL_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_GOAL_POSITION_L;
-    tx_buffer[6] = Position_L;
-    tx_buffer[7] = Position_H;
-    tx_buffer[8] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 9);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return write<MX28Reg::GoalPosition>(ID, Position);
 }
 
 int JetsonMX28::moveSpeed(unsigned char ID, int Position, int Speed)
 {
-    char Position_H,Position_L,Speed_H,Speed_L;
+    unsigned char Data[4];
     
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-   
-    Position_H = Position >> 8;
-    Position_L = Position;
-    Speed_H = Speed >> 8;
-    Speed_L = Speed;
-	Checksum = (~(ID + MX_GOAL_SP_LENGTH + MX_WRITE_DATA + MX_GOAL_POSITION_L + Position_L + Position_H + Speed_L + Speed_H))&0xFF;
+    Data[0] = Position;
+    Data[1] = Position >> 8;
+    Data[2] = Speed;
+    Data[3] = Speed >> 8;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_GOAL_SP_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_GOAL_POSITION_L;
-    tx_buffer[6] = Position_L;
-    tx_buffer[7] = Position_H;
-    tx_buffer[8] = Speed_L;
-    tx_buffer[9] = Speed_H;
-    tx_buffer[10] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 11);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return writeRange<MX28Reg::GoalPosition, MX28Reg::GoalSpeed>(ID, Data);
 }
 
 int JetsonMX28::moveDeg(unsigned char ID, int Degrees)
@@ -305,1108 +471,1059 @@ int JetsonMX28::moveSpeedDeg(unsigned char ID, int Degrees, int Speed)
 
 int JetsonMX28::setEndless(unsigned char ID,bool Status)
 {
-
-    if ( Status ) {	// for continous mode
-	    char MX_CCW_AL_LT = 0;
-	    Checksum = (~(ID + MX_GOAL_LENGTH + MX_WRITE_DATA + MX_CCW_ANGLE_LIMIT_L))&0xFF;
-    
-        memset(tx_buffer, 0, sizeof(tx_buffer) );
+    if ( Status ) {	// for continous mode, both angle limits 0
+        unsigned char Limits[4] = {0, 0, 0, 0};
         
-	    TRANSMIT_ON(gpio_status);
-        tx_buffer[0] = MX_START;
-        tx_buffer[1] = MX_START;
-        tx_buffer[2] = ID;
-        tx_buffer[3] = MX_GOAL_SP_LENGTH;
-        tx_buffer[4] = MX_WRITE_DATA;
-        tx_buffer[5] = MX_CW_ANGLE_LIMIT_L;
-        tx_buffer[6] = MX_CCW_AL_LT;
-        tx_buffer[7] = MX_CCW_AL_LT;
-        tx_buffer[8] = MX_CCW_AL_LT;
-        tx_buffer[9] = MX_CCW_AL_LT;
-        tx_buffer[10]= Checksum;
-        
-	    count = write(uart0_filestream, &tx_buffer, 11);
-	    if (count < 0)
-	    {
-		    printf("UART TX error\n");
-	    }
-	
-	    usleep(TX_DELAY_TIME);
-	    TRANSMIT_OFF(gpio_status);
-
-        return 0;
-    
+        return writeRange<MX28Reg::CWAngleLimit, MX28Reg::CCWAngleLimit>(ID, Limits);
     }
     else // for servo mode
     {
 	    turn(ID,0,0);
-	    Checksum = (~(ID + MX_GOAL_LENGTH + MX_WRITE_DATA + MX_CCW_ANGLE_LIMIT_L + MX_CCW_AL_L + MX_CCW_AL_H))&0xFF;
-    
-        memset(tx_buffer, 0, sizeof(tx_buffer) );
-        
-	    TRANSMIT_ON(gpio_status);
-
-        tx_buffer[0] = MX_START;
-        tx_buffer[1] = MX_START;
-        tx_buffer[2] = ID;
-        tx_buffer[3] = MX_GOAL_LENGTH;
-        tx_buffer[4] = MX_WRITE_DATA;
-        tx_buffer[5] = MX_CCW_ANGLE_LIMIT_L;
-        tx_buffer[6] = MX_CCW_AL_L;
-        tx_buffer[7] = MX_CCW_AL_H;
-        tx_buffer[8] = Checksum;
-        
-	    count = write(uart0_filestream, &tx_buffer, 9);
-	    if (count < 0)
-	    {
-		    printf("UART TX error\n");
-	    }
-	
-	    usleep(TX_DELAY_TIME);
-	    TRANSMIT_OFF(gpio_status);
-
-        return 0;
+	    
+	    return write<MX28Reg::CCWAngleLimit>(ID, MX_CCW_AL_L + (MX_CCW_AL_H << 8));
     }
 }
 
+// Wheel mode speed, bit 10 of the goal speed turns clockwise
 int JetsonMX28::turn(unsigned char ID, bool SIDE, int Speed)
 {
-    
-	if (SIDE == 0){
-		char Speed_H,Speed_L;
-		Speed_H = Speed >> 8;
-		Speed_L = Speed;
-		Checksum = (~(ID + MX_SPEED_LENGTH + MX_WRITE_DATA + MX_GOAL_SPEED_L + Speed_L + Speed_H))&0xFF;
-    
-	    TRANSMIT_ON(gpio_status);
-        tx_buffer[0] = MX_START;
-        tx_buffer[1] = MX_START;
-        tx_buffer[2] = ID;
-        tx_buffer[3] = MX_SPEED_LENGTH;
-        tx_buffer[4] = MX_WRITE_DATA;
-        tx_buffer[5] = MX_GOAL_SPEED_L;
-        tx_buffer[6] = Speed_L;
-        tx_buffer[7] = Speed_H;
-        tx_buffer[8] = Checksum;
-        
-	    count = write(uart0_filestream, &tx_buffer, 9);
-	    if (count < 0)
-	    {
-		    printf("UART TX error\n");
-	    }
-	
-	    usleep(TX_DELAY_TIME);
-	    TRANSMIT_OFF(gpio_status);
-
-        return 0;
-	}
-	else
-	{
-		char Speed_H,Speed_L;
-		Speed_H = (Speed >> 8) + 4;
-		Speed_L = Speed;
-		Checksum = (~(ID + MX_SPEED_LENGTH + MX_WRITE_DATA + MX_GOAL_SPEED_L + Speed_L + Speed_H))&0xFF;
-    
-	    TRANSMIT_ON(gpio_status);
-        tx_buffer[0] = MX_START;
-        tx_buffer[1] = MX_START;
-        tx_buffer[2] = ID;
-        tx_buffer[3] = MX_SPEED_LENGTH;
-        tx_buffer[4] = MX_WRITE_DATA;
-        tx_buffer[5] = MX_GOAL_SPEED_L;
-        tx_buffer[6] = Speed_L;
-        tx_buffer[7] = Speed_H;
-        tx_buffer[8] = Checksum;
-        
-	    count = write(uart0_filestream, &tx_buffer, 9);
-	    if (count < 0)
-	    {
-		    printf("UART TX error\n");
-	    }
-	
-	    usleep(TX_DELAY_TIME);
-	    TRANSMIT_OFF(gpio_status);
-
-        return 0;
-		}
+    if (SIDE == LEFT)
+        return write<MX28Reg::GoalSpeed>(ID, Speed);
+    else
+        return write<MX28Reg::GoalSpeed>(ID, Speed + 1024);
 }
 
 int JetsonMX28::moveRW(unsigned char ID, int Position)
 {
-
-    char Position_H,Position_L;
+    unsigned char Data[2];
     
-    Position_H = Position >> 8;
-    Position_L = Position;
+    Data[0] = Position;
+    Data[1] = Position >> 8;
     
-    Checksum = (~(ID + MX_GOAL_LENGTH + MX_REG_WRITE + MX_GOAL_POSITION_L + Position_L + Position_H))&0xFF;
-        
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_GOAL_LENGTH;
-    tx_buffer[4] = MX_REG_WRITE;
-    tx_buffer[5] = MX_GOAL_POSITION_L;
-    tx_buffer[6] = Position_L;
-    tx_buffer[7] = Position_H;
-    tx_buffer[8] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 9);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return sendRegisters<MX_REG_WRITE, MX_GOAL_POSITION_L, 2>(ID, Data);
 }
 
 int JetsonMX28::moveSpeedRW(unsigned char ID, int Position, int Speed)
 {
-
-    char Position_H,Position_L,Speed_H,Speed_L;
+    unsigned char Data[4];
     
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-   
-    Position_H = Position >> 8;
-    Position_L = Position;
-    Speed_H = Speed >> 8;
-    Speed_L = Speed;
-	Checksum = (~(ID + MX_GOAL_SP_LENGTH + MX_REG_WRITE + MX_GOAL_POSITION_L + Position_L + Position_H + Speed_L + Speed_H))&0xFF;
+    Data[0] = Position;
+    Data[1] = Position >> 8;
+    Data[2] = Speed;
+    Data[3] = Speed >> 8;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_GOAL_SP_LENGTH;
-    tx_buffer[4] = MX_REG_WRITE;
-    tx_buffer[5] = MX_GOAL_POSITION_L;
-    tx_buffer[6] = Position_L;
-    tx_buffer[7] = Position_H;
-    tx_buffer[8] = Speed_L;
-    tx_buffer[9] = Speed_H;
-    tx_buffer[10] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 11);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return sendRegisters<MX_REG_WRITE, MX_GOAL_POSITION_L, 4>(ID, Data);
+}
 
-    return 0;
+/*
+    Registers a write of Length bytes from Address that ID carries out at the next ACTION
+    Returns 0, -1 if the status packet did not arrive or the negative error byte
+*/
+int JetsonMX28::regWrite(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    unsigned char *Params = reserve(Length + 1);
+    if(Params == NULL)
+        return -1;
+    
+    Params[0] = Address;
+    memcpy(&Params[1], Data, Length);
+    commit(ID, MX_REG_WRITE, Length + 1);
+    
+    return command();
 }
 
 void JetsonMX28::action()
 {
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = BROADCAST_ID;
-    tx_buffer[3] = MX_ACTION_LENGTH;
-    tx_buffer[4] = MX_ACTION;
-    tx_buffer[5] = MX_ACTION_CHECKSUM;
-    
-	count = write(uart0_filestream, &tx_buffer, 6);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+	sendInstruction<MX_ACTION>(BROADCAST_ID);
 }
 
-int JetsonMX28::torqueStatus( unsigned char ID, bool Status)
+int JetsonMX28::syncWrite(unsigned char Address, unsigned char Length, const unsigned char *IDs, const unsigned char *Data, int Count)
 {
+    unsigned char *Block = reserveSync(Address, Length, Count);
+    if(Block == NULL)
+        return -1;
     
-    Checksum = (~(ID + MX_TORQUE_LENGTH + MX_WRITE_DATA + MX_TORQUE_ENABLE + Status))&0xFF;
+    for(int servo = 0; servo < Count; servo++)
+    {
+        Block[0] = IDs[servo];
+        memcpy(&Block[1], &Data[servo * Length], Length);
+        Block += Length + 1;
+    }
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_TORQUE_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_TORQUE_ENABLE;
-    tx_buffer[6] = Status;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    commit(BROADCAST_ID, MX_SYNC_WRITE, (Length + 1) * Count + 2);
+    return command();
 }
 
-int JetsonMX28::ledStatus( unsigned char ID, bool Status)
+/*
+    Reserves a SYNC_WRITE packet for Count servos in the TX arena, the address and
+    length parameters are filled in
+    Returns where the first servo's ID and data go, NULL if it does not fit in one packet
+*/
+unsigned char *JetsonMX28::reserveSync(unsigned char Address, unsigned char Length, int Count)
 {
+    if( (Count <= 0) | (Length == 0) | ((Length + 1) * Count + MX_SYNC_WRITE_LENGTH > MX_MAX_PACKET_LENGTH) )
+    {
+        printf("SYNC WRITE error: %d servos x %d bytes does not fit in one packet\n", Count, Length);
+        return NULL;
+    }
     
-    Checksum = (~(ID + MX_LED_LENGTH + MX_WRITE_DATA + MX_LED + Status))&0xFF;
+    unsigned char *Params = reserve((Length + 1) * Count + 2);
+    Params[0] = Address;
+    Params[1] = Length;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_LED_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_LED;
-    tx_buffer[6] = Status;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return &Params[2];
 }
 
-int JetsonMX28::setTempLimit(unsigned char ID, unsigned char Temperature)
+int JetsonMX28::syncMove(const unsigned char *IDs, const int *Positions, int Count)
 {
+    unsigned char *Block = reserveSync(MX_GOAL_POSITION_L, 2, Count);
+    if(Block == NULL)
+        return -1;
     
-    Checksum = (~(ID + MX_TL_LENGTH +MX_WRITE_DATA+ MX_LIMIT_TEMPERATURE + Temperature))&0xFF;
+    for(int servo = 0; servo < Count; servo++, Block += 3)
+    {
+        Block[0] = IDs[servo];
+        Block[1] = Positions[servo];
+        Block[2] = Positions[servo] >> 8;
+    }
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_TL_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_LIMIT_TEMPERATURE;
-    tx_buffer[6] = Temperature;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    commit(BROADCAST_ID, MX_SYNC_WRITE, 3 * Count + 2);
+    return command();
+}
 
-    return 0;
+int JetsonMX28::syncMoveSpeed(const unsigned char *IDs, const int *Positions, const int *Speeds, int Count)
+{
+    unsigned char *Block = reserveSync(MX_GOAL_POSITION_L, 4, Count);
+    if(Block == NULL)
+        return -1;
+    
+    for(int servo = 0; servo < Count; servo++, Block += 5)
+    {
+        Block[0] = IDs[servo];
+        Block[1] = Positions[servo];
+        Block[2] = Positions[servo] >> 8;
+        Block[3] = Speeds[servo];
+        Block[4] = Speeds[servo] >> 8;
+    }
+    
+    commit(BROADCAST_ID, MX_SYNC_WRITE, 5 * Count + 2);
+    return command();
 }
 
-int JetsonMX28::setVoltageLimit(unsigned char ID, unsigned char DVoltage, unsigned char UVoltage)
+int JetsonMX28::syncTorqueLimit(const unsigned char *IDs, const int *Limits, int Count)
 {
+    unsigned char *Block = reserveSync(MX_TORQUE_LIMIT_L, 2, Count);
+    if(Block == NULL)
+        return -1;
     
-    Checksum = (~(ID + MX_VL_LENGTH +MX_WRITE_DATA+ MX_DOWN_LIMIT_VOLTAGE + DVoltage + UVoltage))&0xFF;
+    for(int servo = 0; servo < Count; servo++, Block += 3)
+    {
+        Block[0] = IDs[servo];
+        Block[1] = Limits[servo];
+        Block[2] = Limits[servo] >> 8;
+    }
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_VL_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_DOWN_LIMIT_VOLTAGE;
-    tx_buffer[6] = DVoltage;
-	tx_buffer[7] = UVoltage;
-    tx_buffer[8] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 9);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    commit(BROADCAST_ID, MX_SYNC_WRITE, 3 * Count + 2);
+    return command();
+}
 
-    return 0;
+int JetsonMX28::torqueStatus( unsigned char ID, bool Status)
+{
+    return write<MX28Reg::TorqueEnable>(ID, Status);
 }
 
-int JetsonMX28::setAngleLimit(unsigned char ID, int CWLimit, int CCWLimit)
+int JetsonMX28::ledStatus( unsigned char ID, bool Status)
 {
-    char CW_H,CW_L,CCW_H,CCW_L;
-    
-    CW_H = CWLimit >> 8;    
-    CW_L = CWLimit;
-    CCW_H = CCWLimit >> 8;
-    CCW_L = CCWLimit;  
+    return write<MX28Reg::LED>(ID, Status);
+}
+
+/*
+    Writes the same bytes to every servo on the bus with one broadcast WRITE_DATA,
+    nobody answers it so it costs one packet and no turnaround
+    @Address - first register
+    @Data - Length bytes
+    Returns 0 or -1 on a UART error
+*/
+int JetsonMX28::writeAll(unsigned char Address, const unsigned char *Data, int Length)
+{
+    unsigned char *Params = reserve(Length + 1);
+    if(Params == NULL)
+        return -1;
     
-	Checksum = (~(ID + MX_VL_LENGTH +MX_WRITE_DATA+ MX_CW_ANGLE_LIMIT_L + CW_H + CW_L + MX_CCW_ANGLE_LIMIT_L + CCW_H + CCW_L))&0xFF;
+    Params[0] = Address;
+    memcpy(&Params[1], Data, Length);
+    commit(BROADCAST_ID, MX_WRITE_DATA, Length + 1);
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_CCW_CW_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_CW_ANGLE_LIMIT_L;
-    tx_buffer[6] = CW_L;
-    tx_buffer[7] = CW_H;
-    tx_buffer[8] = MX_CCW_ANGLE_LIMIT_L;
-    tx_buffer[9] = CCW_L;
-    tx_buffer[10] = CCW_H;
-    tx_buffer[11] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 12);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return command();
+}
 
-    return 0;
+int JetsonMX28::torqueAll(bool Status)
+{
+    return write<MX28Reg::TorqueEnable>(BROADCAST_ID, Status);
 }
 
-int JetsonMX28::setMaxTorque(unsigned char ID, int MaxTorque)
+int JetsonMX28::ledAll(bool Status)
+{
+    return write<MX28Reg::LED>(BROADCAST_ID, Status);
+}
+
+int JetsonMX28::torqueLimitAll(int Limit)
 {
-    char MaxTorque_H,MaxTorque_L;
+    return write<MX28Reg::TorqueLimit>(BROADCAST_ID, Limit);
+}
+
+/*
+    Turns the torque of every servo off ahead of anything else. Packets waiting in the
+    TX arena or a batch, dirty shadow bytes and bytes the UART driver has not sent yet
+    are dropped, then one 8 byte broadcast WRITE_DATA goes out on its own.
+    Returns 0 or -1 on a UART error
+*/
+int JetsonMX28::emergencyStop()
+{
+    // What was queued is never sent, the shadow must not hold it. A batch in progress
+    // ends here, later commands go out one by one again.
+    batching = 0;
+    tx_used = tx_packets = tx_replies = 0;
+    tx_reserved = -1;
+    for(int servo = 0; servo < MX_MAX_SERVOS; servo++)
+    {
+        shadow_valid[servo] &= ~shadow_dirty[servo];
+        shadow_dirty[servo] = 0;
+    }
+    tcflush(uart0_filestream, TCOFLUSH);
     
-    MaxTorque_H = MaxTorque >> 8;
-    MaxTorque_L = MaxTorque;
+    // Replies to what was already on the wire are no longer wanted
+    rx_stale = 1;
     
-	Checksum = (~(ID + MX_MT_LENGTH + MX_WRITE_DATA + MX_MAX_TORQUE_L + MaxTorque_L + MaxTorque_H))&0xFF;
+    unsigned char *Params = reserve(2);
+    Params[0] = MX_TORQUE_ENABLE;
+    Params[1] = OFF;
+    commit(BROADCAST_ID, MX_WRITE_DATA, 2);
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_MT_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_MAX_TORQUE_L;
-    tx_buffer[6] = MaxTorque_L;
-    tx_buffer[7] = MaxTorque_H;
-    tx_buffer[8] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 9);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return transmit();
+}
 
-    return 0;
+int JetsonMX28::setTempLimit(unsigned char ID, unsigned char Temperature)
+{
+    return write<MX28Reg::LimitTemperature>(ID, Temperature);
 }
 
-int JetsonMX28::setSRL(unsigned char ID, unsigned char SRL)
+int JetsonMX28::setVoltageLimit(unsigned char ID, unsigned char DVoltage, unsigned char UVoltage)
 {
+    unsigned char Data[2];
     
-    Checksum = (~(ID + MX_SRL_LENGTH + MX_WRITE_DATA + MX_RETURN_LEVEL + SRL))&0xFF;
+    Data[0] = DVoltage;
+    Data[1] = UVoltage;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_SRL_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_RETURN_LEVEL;
-    tx_buffer[6] = SRL;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return writeRange<MX28Reg::DownLimitVoltage, MX28Reg::UpLimitVoltage>(ID, Data);
 }
 
-int JetsonMX28::setRDT(unsigned char ID, unsigned char RDT)
+int JetsonMX28::setAngleLimit(unsigned char ID, int CWLimit, int CCWLimit)
 {
+    unsigned char Data[4];
     
-   Checksum = (~(ID + MX_RDT_LENGTH + MX_WRITE_DATA + MX_RETURN_DELAY_TIME + (RDT/2)))&0xFF;
+    Data[0] = CWLimit;
+    Data[1] = CWLimit >> 8;
+    Data[2] = CCWLimit;
+    Data[3] = CCWLimit >> 8;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_RDT_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_RETURN_DELAY_TIME;
-    tx_buffer[6] = RDT/2;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return writeRange<MX28Reg::CWAngleLimit, MX28Reg::CCWAngleLimit>(ID, Data);
+}
 
-    return 0;
+int JetsonMX28::setMaxTorque(unsigned char ID, int MaxTorque)
+{
+    return write<MX28Reg::MaxTorque>(ID, MaxTorque);
 }
 
-int JetsonMX28::setLEDAlarm(unsigned char ID, unsigned char LEDAlarm)
+int JetsonMX28::setSRL(unsigned char ID, unsigned char SRL)
 {
+    // The status packet of this write already follows the new level
+    for(int servo = 0; (servo < MX_MAX_SERVOS) & (SRL <= MX28Reg::ReturnLevel::Max); servo++)
+    {
+        if( (ID == BROADCAST_ID) | (servo == ID) )
+            return_level[servo] = SRL;
+    }
     
-    Checksum = (~(ID + MX_LEDALARM_LENGTH + MX_WRITE_DATA + MX_ALARM_LED + LEDAlarm))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_LEDALARM_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_ALARM_LED;
-    tx_buffer[6] = LEDAlarm;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
+	return write<MX28Reg::ReturnLevel>(ID, SRL);
+}
+
+// @RDT - return delay in micro seconds, 2 micro second steps
+int JetsonMX28::setRDT(unsigned char ID, unsigned char RDT)
+{
+	int Error = write<MX28Reg::ReturnDelayTime>(ID, RDT/2);
+	return_delay = RDT;
+	
+	// The response time changes with the return delay
+	for(int servo = 0; servo < MX_MAX_SERVOS; servo++)
 	{
-		printf("UART TX error\n");
+	    if( (ID == BROADCAST_ID) | (servo == ID) )
+	    {
+	        links[servo].Timeout = 0;
+	        links[servo].Response.reset();
+	    }
 	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
 
-    return 0;
+    return Error;
 }
 
-int JetsonMX28::setShutdownAlarm(unsigned char ID, unsigned char SALARM)
+int JetsonMX28::setLEDAlarm(unsigned char ID, unsigned char LEDAlarm)
 {
-    
-    Checksum = (~(ID + MX_SALARM_LENGTH + MX_ALARM_SHUTDOWN + MX_ALARM_LED + SALARM))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_SALARM_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_ALARM_SHUTDOWN;
-    tx_buffer[6] = SALARM;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return write<MX28Reg::AlarmLED>(ID, LEDAlarm);
+}
 
-    return 0;
+int JetsonMX28::setShutdownAlarm(unsigned char ID, unsigned char SALARM)
+{
+    return write<MX28Reg::AlarmShutdown>(ID, SALARM);
 }
 
 int JetsonMX28::setCMargin(unsigned char ID, unsigned char CWCMargin, unsigned char CCWCMargin)
 {
+    unsigned char Data[2];
     
-    Checksum = (~(ID + MX_CM_LENGTH +MX_WRITE_DATA+ MX_CW_COMPLIANCE_MARGIN + CWCMargin + MX_CCW_COMPLIANCE_MARGIN + CCWCMargin))&0xFF;
+    Data[0] = CWCMargin;
+    Data[1] = CCWCMargin;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_CM_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_CW_COMPLIANCE_MARGIN;
-    tx_buffer[6] = CWCMargin;
-    tx_buffer[7] = MX_CCW_COMPLIANCE_MARGIN;
-    tx_buffer[8] = CCWCMargin;
-    tx_buffer[9] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 10);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return writeRange<MX28Reg::CWComplianceMargin, MX28Reg::CCWComplianceMargin>(ID, Data);
 }
 
 int JetsonMX28::setCSlope(unsigned char ID, unsigned char CWCSlope, unsigned char CCWCSlope)
 {
+    unsigned char Data[2];
     
-    Checksum = (~(ID + MX_CS_LENGTH +MX_WRITE_DATA+ MX_CW_COMPLIANCE_SLOPE + CWCSlope + MX_CCW_COMPLIANCE_SLOPE + CCWCSlope))&0xFF;
+    Data[0] = CWCSlope;
+    Data[1] = CCWCSlope;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_CS_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_CW_COMPLIANCE_SLOPE;
-    tx_buffer[6] = CWCSlope;
-    tx_buffer[7] = MX_CCW_COMPLIANCE_SLOPE;
-    tx_buffer[8] = CCWCSlope;
-    tx_buffer[9] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 10);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return writeRange<MX28Reg::CWComplianceSlope, MX28Reg::CCWComplianceSlope>(ID, Data);
 }
 
 int JetsonMX28::setPunch(unsigned char ID, int Punch)
 {
-
-    char Punch_H,Punch_L;
-    
-    Punch_H = Punch >> 8;
-    Punch_L = Punch;
-    
-	Checksum = (~(ID + MX_PUNCH_LENGTH + MX_WRITE_DATA + MX_PUNCH_L + Punch_L + Punch_H))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_PUNCH_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_PUNCH_L;
-    tx_buffer[6] = Punch_L;
-    tx_buffer[7] = Punch_H;
-    tx_buffer[8] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 9);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
-    return 0;
+    return write<MX28Reg::Punch>(ID, Punch);
 }
 
 int JetsonMX28::moving(unsigned char ID)
 {
+    return read<MX28Reg::Moving>(ID);
+}
 
-    Checksum = (~(ID + MX_MOVING_LENGTH  + MX_READ_DATA + MX_MOVING + MX_BYTE_READ))&0xFF;
-    
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_MOVING_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_MOVING;
-    tx_buffer[6] = MX_BYTE_READ;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+int JetsonMX28::lockRegister(unsigned char ID)
+{
+    return write<MX28Reg::Lock>(ID, LOCK);
+}
 
-	Moving_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
-	{
-	    Time_Counter++;
-	    usleep(1000);
-	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
-	{
-        printf("ERROR! NOTHING READ!\n");
-        return -1;
-    }
-    else
-    {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
-        {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
-            {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
-                {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
-                }
-                    
-                Moving_Byte = rx_buffer[iter+5];
-                return Moving_Byte;  
-            }
-        }
-    }
-	    
-    return Moving_Byte;
+int JetsonMX28::RWStatus(unsigned char ID)
+{
+    return read<MX28Reg::RegisteredInstruction>(ID);
 }
 
-int JetsonMX28::lockRegister(unsigned char ID)
+int JetsonMX28::readTemperature(unsigned char ID)
 {
-    
-    Checksum = (~(ID + MX_LR_LENGTH + MX_WRITE_DATA + MX_LOCK + LOCK))&0xFF;
+    return read<MX28Reg::PresentTemperature>(ID);
+}
 
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_LR_LENGTH;
-    tx_buffer[4] = MX_WRITE_DATA;
-    tx_buffer[5] = MX_LOCK;
-    tx_buffer[6] = LOCK;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+int JetsonMX28::readVoltage(unsigned char ID)
+{
+    return read<MX28Reg::PresentVoltage>(ID);
+}
 
-    return 0;                 // Return the read error
+int JetsonMX28::readPosition(unsigned char ID)
+{
+    return read<MX28Reg::PresentPosition>(ID);
 }
 
-int JetsonMX28::RWStatus(unsigned char ID)
+int JetsonMX28::readSpeed(unsigned char ID)
+{
+    return read<MX28Reg::PresentSpeed>(ID);
+}
+
+int JetsonMX28::readLoad(unsigned char ID)
 {
+    return read<MX28Reg::PresentLoad>(ID);
+}
 
-    Checksum = (~(ID + MX_RWS_LENGTH  + MX_READ_DATA + MX_REGISTERED_INSTRUCTION + MX_BYTE_READ))&0xFF;
+/*
+    Reads position, speed, load, voltage, temperature, registered and moving
+    with a single READ_DATA request
+    Returns 0, -1 if nothing was read or the negative error byte
+*/
+int JetsonMX28::readState(unsigned char ID, MX28State *State)
+{
+    MX28Packet Packet;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_RWS_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_REGISTERED_INSTRUCTION;
-    tx_buffer[6] = MX_BYTE_READ;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    int Error = readData(ID, MX_PRESENT_POSITION_L, MX_STATE_LENGTH, &Packet);
+    if(Error != 0)
+    {
+        printf("ERROR!\n");
+        return (Error < 0) ? -1 : (Error * (-1));
+    }
+    
+    decodeState(Packet.Params, State);
+    
+    return 0;
+}
 
-	RWS_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
-	{
-	    Time_Counter++;
-	    usleep(1000);
-	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
-	{
-        printf("ERROR! NOTHING READ!\n");
+/*
+    Reads several servos with a single BULK_READ request. The servos answer one after
+    the other in the order given and their data is kept until the next bulkRead().
+    Servos at status return level 0 never answer and offline servos (see
+    setOfflineRetry()) are not expected to, either would stop the ones after them, so
+    they are left out of the request and counted as skipped.
+    @IDs       - servo IDs
+    @Addresses - first register to read on each servo
+    @Lengths   - bytes to read on each servo
+    Returns the number of servos that answered or -1 on a bad request
+*/
+int JetsonMX28::bulkRead(const unsigned char *IDs, const unsigned char *Addresses, const unsigned char *Lengths, int Count)
+{
+    if( (Count <= 0) | (Count > MX_MAX_BULK) )
+    {
+        printf("BULK READ error: %d servos does not fit in one packet\n", Count);
         return -1;
     }
-    else
+    
+    bulk_count = 0;
+    for(int servo = 0; servo < Count; servo++)
     {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
+        if( (Lengths[servo] == 0) | (Addresses[servo] + Lengths[servo] > MX_TABLE_SIZE) )
         {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
-            {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
-                {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
-                }
-                    
-                RWS_Byte = rx_buffer[iter+5];
-                return RWS_Byte;  
-            }
+            printf("BULK READ error: bad register range for ID %d\n", IDs[servo]);
+            return -1;
         }
     }
-	    
-    return RWS_Byte;
-}
-
-int JetsonMX28::readTemperature(unsigned char ID)
-{
-
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-    memset(tx_buffer, 0, sizeof(rx_buffer) );
-   
-    Checksum = (~(ID + MX_TEM_LENGTH  + MX_READ_DATA + MX_PRESENT_TEMPERATURE + MX_BYTE_READ))&0xFF;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_TEM_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_PRESENT_TEMPERATURE;
-    tx_buffer[6] = MX_BYTE_READ;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
+    unsigned char *Params = reserve(Count * MX_BULK_READ_LENGTH + 1);
+    Params[0] = 0;
     
-	Temperature_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
-	{
-	    Time_Counter++;
-	    usleep(1000);
-	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
-	{
-        printf("ERROR! NOTHING READ!\n");
-        return -1;
-    }
-    else
+    int index = 1;
+    for(int servo = 0; servo < Count; servo++)
     {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
+        bulk[servo].ID = IDs[servo];
+        bulk[servo].Address = Addresses[servo];
+        bulk[servo].Length = Lengths[servo];
+        bulk[servo].Error = -1;
+        bulk[servo].Asked = (returnLevel(IDs[servo]) != 0) && available(IDs[servo]);
+        
+        if(!bulk[servo].Asked)
         {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
-            {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
-                {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
-                }
-                    
-                Temperature_Byte = rx_buffer[iter+6];
-                return Temperature_Byte;  
-            }
+            statistics->Skipped++;
+            continue;
         }
+        
+        Params[index++] = Lengths[servo];
+        Params[index++] = IDs[servo];
+        Params[index++] = Addresses[servo];
     }
-	    
-    return Temperature_Byte;
-}
-
-int JetsonMX28::readVoltage(unsigned char ID)
-{
-
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-    memset(tx_buffer, 0, sizeof(rx_buffer) );
-   
-    Checksum = (~(ID + MX_VOLT_LENGTH  + MX_READ_DATA + MX_PRESENT_VOLTAGE + MX_BYTE_READ))&0xFF;
+    bulk_count = Count;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_VOLT_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_PRESENT_VOLTAGE;
-    tx_buffer[6] = MX_BYTE_READ;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
-
+    if(index == 1)
+    {
+        tx_reserved = -1;
+        return 0;
+    }
     
-	Voltage_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
-	{
-	    Time_Counter++;
-	    usleep(1000);
-	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
-	{
-        printf("ERROR! NOTHING READ!\n");
+    commit(BROADCAST_ID, MX_BULK_READ, index);
+    if(transmit() < 0)
         return -1;
-    }
-    else
+    
+    MX28Packet Packet;
+    int Replies = 0;
+    for(int servo = 0; servo < bulk_count; servo++)
     {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
+        MX28BulkEntry &entry = bulk[servo];
+        if(!entry.Asked)
+            continue;
+        entry.Error = readPacket(entry.ID, entry.Length, &Packet);
+        if(entry.Error < 0)
         {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
-            {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
-                {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
-                }
-                    
-                Voltage_Byte = rx_buffer[iter+6];
-                return Voltage_Byte;  
-            }
+            missed(entry.ID);
+            break;              // Later servos wait for this one, so they will not answer either
         }
+        memcpy(entry.Data, Packet.Params, entry.Length);
+        if( (entry.Error == 0) & (entry.Address <= MX_RETURN_LEVEL) & (entry.Address + entry.Length > MX_RETURN_LEVEL) )
+            return_level[entry.ID] = entry.Data[MX_RETURN_LEVEL - entry.Address];
+        if( (entry.Error == 0) & (shadow_enabled | cache_enabled) )
+            learn(entry.ID, entry.Address, entry.Data, entry.Length);
+        Replies++;
     }
-	    
-    return Voltage_Byte;
+    
+    return Replies;
 }
 
-int JetsonMX28::readPosition(unsigned char ID)
+/*
+    Returns a 1 or 2 byte value from the last bulkRead(), -1 if it was not read
+    or the negative error byte if the servo reported an error
+*/
+int JetsonMX28::bulkReadData(unsigned char ID, unsigned char Address, unsigned char Length)
 {
+    for(int servo = 0; servo < bulk_count; servo++)
+    {
+        MX28BulkEntry &entry = bulk[servo];
+        
+        if( (entry.ID != ID) | (Address < entry.Address) | (Address + Length > entry.Address + entry.Length) )
+            continue;
+        
+        if(entry.Error != 0)
+            return (entry.Error < 0) ? -1 : (entry.Error * (-1));
+        
+        int offset = Address - entry.Address;
+        if(Length == 2)
+            return entry.Data[offset] + (entry.Data[offset + 1] << 8);
+        return entry.Data[offset];
+    }
+    
+    return -1;
+}
 
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-    memset(tx_buffer, 0, sizeof(rx_buffer) );
-   
-    Checksum = (~(ID + MX_POS_LENGTH  + MX_READ_DATA + MX_PRESENT_POSITION_L + MX_BYTE_READ_POS))&0xFF;
+/*
+    Returns the state of ID from the last bulkRead(), which must have covered
+    MX_PRESENT_POSITION_L to MX_MOVING
+    Returns 0, -1 if it was not read or the negative error byte
+*/
+int JetsonMX28::bulkReadState(unsigned char ID, MX28State *State)
+{
+    for(int servo = 0; servo < bulk_count; servo++)
+    {
+        MX28BulkEntry &entry = bulk[servo];
+        
+        if( (entry.ID != ID) | (entry.Address > MX_PRESENT_POSITION_L) | (entry.Address + entry.Length < MX_MOVING + 1) )
+            continue;
+        
+        if(entry.Error != 0)
+            return (entry.Error < 0) ? -1 : (entry.Error * (-1));
+        
+        decodeState(&entry.Data[MX_PRESENT_POSITION_L - entry.Address], State);
+        return 0;
+    }
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_POS_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_PRESENT_POSITION_L;
-    tx_buffer[6] = MX_BYTE_READ_POS;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return -1;
+}
 
+/*
+    Reads a 1 or 2 byte register value with one READ_DATA request
+    @Cache - false always asks the servo, see readData()
+    Returns the value, -1 if nothing was read or the negative error byte
+*/
+int JetsonMX28::readValue(unsigned char ID, unsigned char Address, int Length, bool Cache)
+{
+    MX28Packet Packet;
     
-	Position_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
-	{
-	    Time_Counter++;
-	    usleep(1000);
-	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
-	{
+    int Error = readData(ID, Address, Length, &Packet, Cache);
+    if(Error < 0)
+    {
         printf("ERROR! NOTHING READ!\n");
         return -1;
     }
-    else
+    if(Error != 0)
     {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
+        printf("ERROR!\n");
+        return (Error * (-1));
+    }
+    
+    if(Length == 2)
+        return Packet.Params[0] + (Packet.Params[1] << 8);
+    return Packet.Params[0];
+}
+
+/*
+    Reads Length bytes from Address on ID with one READ_DATA request, repeating
+    the request up to setRetries() times when no valid reply arrives. Only a read that
+    failed every attempt counts as a miss towards MX_OFFLINE_MISSES. Fresh values in
+    the read cache are returned without a request.
+    @Cache - false always asks the servo, for reads that check what the servo really holds
+    Returns the servo error byte or -1 if no valid packet arrived, the servo is offline
+    or its status return level is 0
+*/
+int JetsonMX28::readData(unsigned char ID, unsigned char Address, int Length, MX28Packet *Packet, bool Cache)
+{
+    if(Cache && cached(ID, Address, Length))
+    {
+        statistics->CacheHits++;
+        Packet->ID = ID;
+        Packet->Error = 0;
+        Packet->Length = Length;
+        Packet->Params = &shadow[ID][Address];
+        return 0;
+    }
+    
+    int Error = -1;
+    for(int attempt = 0; (attempt <= read_retries) & (Error < 0); attempt++)
+    {
+        if( !available(ID) || (returnLevel(ID) == 0) )
+        {
+            statistics->Skipped++;
+            return -1;
+        }
+        if(attempt > 0)
+            statistics->Retries++;
+        
+        unsigned char *Params = reserve(2);
+        Params[0] = Address;
+        Params[1] = Length;
+        commit(ID, MX_READ_DATA, 2);
+        
+        if(transmit() < 0)
+            return -1;
+        
+        Error = readPacket(ID, Length, Packet);
+    }
+    if(Error < 0)
+        missed(ID);
+
+    if( (Error == 0) & (ID < MX_MAX_SERVOS) & (Address <= MX_RETURN_LEVEL) & (Address + Length > MX_RETURN_LEVEL) )
+        return_level[ID] = Packet->Params[MX_RETURN_LEVEL - Address];
+    if( (Error == 0) & (shadow_enabled | cache_enabled) )
+        learn(ID, Address, Packet->Params, Length);
+
+    return Error;
+}
+
+/*
+    Waits for the status packet from ID carrying Length parameters. Packets from
+    other servos or with another length are replies to earlier requests and are dropped.
+    The caller counts the miss with missed(), once per request however often it was sent.
+    Returns the servo error byte or -1 if no valid packet arrived in time
+*/
+int JetsonMX28::readPacket(unsigned char ID, int Length, MX28Packet *Packet)
+{
+    long long now = monotonicMicros();
+    long long deadline = now + responseTimeout(ID) + wireTime(Length);
+    if(deadline > now + RX_TIMEOUT)
+        deadline = now + RX_TIMEOUT;
+    long Waiting = 0;
+    long Decoding = 0;
+    
+    while(1)
+    {
+        long long mark = now;
+        while(decode(Packet))
         {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
+            if( (Packet->ID == ID) & (Packet->Length == Length) )
             {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
-                {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
-                }
-                    
-                Position_Byte = rx_buffer[iter+5] + (rx_buffer[iter+6] << 8);
-                return Position_Byte;  
+                now = monotonicMicros();
+                recordRead(ID, Waiting, Decoding + (now - mark), now - rx_reference);
+                rx_reference = now;
+                return Packet->Error;
             }
+            statistics->StalePackets++;
         }
+        now = monotonicMicros();
+        Decoding += now - mark;
+        
+        mark = now;
+        int bytes = fill(deadline);
+        now = monotonicMicros();
+        Waiting += now - mark;
+        if(bytes <= 0)
+            break;
     }
-	    
-    return Position_Byte;
+    
+    // The reply may still arrive, drop it before the next request
+    statistics->Timeouts++;
+    rx_stale = 1;
+    return -1;
 }
 
-int JetsonMX28::readSpeed(unsigned char ID)
+/*
+    Records the receive phases of the last request and the response time of ID.
+    The response times are always kept, they set the adaptive timeout of ID.
+*/
+void JetsonMX28::recordRead(unsigned char ID, long Waiting, long Decoding, long Response)
 {
+    if(stats_enabled)
+    {
+        statistics->Phase[last_instruction][MX_PHASE_RX_WAIT].record(Waiting);
+        statistics->Phase[last_instruction][MX_PHASE_DECODE].record(Decoding);
+    }
+    
+    if(ID >= MX_MAX_SERVOS)
+        return;
+    
+    if(stats_enabled)
+    {
+        statistics->Servo[ID][MX_PHASE_RX_WAIT].record(Waiting);
+        statistics->Servo[ID][MX_PHASE_DECODE].record(Decoding);
+    }
+    statistics->Servo[ID][MX_PHASE_RESPONSE].record(Response);
+    
+    MX28Histogram &Samples = links[ID].Response;
+    Samples.record(Response);
+    links[ID].Misses = 0;
+    
+    if(Samples.Count % MX_TIMEOUT_SAMPLES == 0)
+        links[ID].Timeout = Samples.percentile(99) + timeout_margin;
+}
 
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-    memset(tx_buffer, 0, sizeof(rx_buffer) );
-   
-    Checksum = (~(ID + MX_POS_LENGTH  + MX_READ_DATA + MX_PRESENT_SPEED_L + MX_BYTE_READ_POS))&0xFF;
+// False while ID is offline and not due for another try
+bool JetsonMX28::available(unsigned char ID)
+{
+    if( (ID >= MX_MAX_SERVOS) || (links[ID].Misses < MX_OFFLINE_MISSES) )
+        return true;
     
-	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_POS_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_PRESENT_SPEED_L;
-    tx_buffer[6] = MX_BYTE_READ_POS;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
-	if (count < 0)
-	{
-		printf("UART TX error\n");
-	}
-	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+    return monotonicMicros() >= links[ID].Retry;
+}
 
+// Counts a timeout of ID, enough of them in a row put it offline
+void JetsonMX28::missed(unsigned char ID)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return;
     
-	Speed_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
-	{
-	    Time_Counter++;
-	    usleep(1000);
-	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
-	{
-        printf("ERROR! NOTHING READ!\n");
-        return -1;
-    }
-    else
+    links[ID].Misses++;
+    if(links[ID].Misses >= MX_OFFLINE_MISSES)
+        links[ID].Retry = monotonicMicros() + offline_retry;
+}
+
+/*
+    Status packet decoder. Walks the bytes between rx_scan and rx_tail one at a time,
+    keeping its state between calls so packets split across reads are picked up where
+    they left off. A bad length or checksum restarts the search one byte after the
+    rejected header.
+    Returns 1 with Packet pointing into rx_buffer, 0 when more bytes are needed
+*/
+int JetsonMX28::decode(MX28Packet *Packet)
+{
+    while(rx_scan < rx_tail)
     {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
+        unsigned char Byte = rx_buffer[rx_scan];
+        
+        switch(rx_state)
         {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
+            case RX_HEADER_1:
+                rx_head = rx_scan++;
+                if(Byte == MX_START)
+                    rx_state = RX_HEADER_2;
+                break;
+            
+            case RX_HEADER_2:
+                rx_state = (Byte == MX_START) ? RX_ID : RX_HEADER_1;
+                rx_scan++;
+                break;
+            
+            case RX_ID:
+                if(Byte == MX_START)
+                    rx_head++;              // Extra 0xFF, the header starts one byte later
+                else if(Byte == BROADCAST_ID)
+                {
+                    statistics->FramingErrors++;
+                    resync();
+                    break;
+                }
+                else
+                    rx_state = RX_LENGTH;
+                rx_scan++;
+                break;
+            
+            case RX_LENGTH:
+                if( (Byte < 2) | (Byte > MX_TABLE_SIZE + 2) )
+                {
+                    statistics->FramingErrors++;
+                    resync();
+                    break;
+                }
+                rx_state = RX_PARAMS;
+                rx_scan++;
+                break;
+            
+            case RX_PARAMS:
             {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
+                int Packet_Length = rx_buffer[rx_head + 3] + 4;
+                if(rx_tail - rx_head < Packet_Length)
+                {
+                    rx_scan = rx_tail;
+                    return 0;
+                }
+                
+                unsigned char Sum = 0;
+                for(int iter = rx_head + 2; iter < rx_head + Packet_Length - 1; iter++)
+                    Sum += rx_buffer[iter];
+                if( ((~Sum)&0xFF) != rx_buffer[rx_head + Packet_Length - 1] )
                 {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
+                    statistics->ChecksumErrors++;
+                    resync();
+                    break;
                 }
-                    
-                Speed_Byte = rx_buffer[iter+5] + (rx_buffer[iter+6] << 8);
-                return Speed_Byte;  
+                
+                Packet->ID = rx_buffer[rx_head + 2];
+                Packet->Length = rx_buffer[rx_head + 3] - 2;
+                Packet->Error = rx_buffer[rx_head + 4];
+                Packet->Params = &rx_buffer[rx_head + 5];
+                
+                statistics->RxPackets++;
+                rx_head += Packet_Length;
+                rx_scan = rx_head;
+                rx_state = RX_HEADER_1;
+                return 1;
             }
         }
     }
-	    
-    return Speed_Byte;
+    
+    return 0;
 }
 
-int JetsonMX28::readLoad(unsigned char ID)
+// Drops the header at rx_head and searches again from the byte after it
+void JetsonMX28::resync()
 {
+    rx_head++;
+    rx_scan = rx_head;
+    rx_state = RX_HEADER_1;
+}
 
-    memset(tx_buffer, 0, sizeof(tx_buffer) );
-    memset(tx_buffer, 0, sizeof(rx_buffer) );
-   
-    Checksum = (~(ID + MX_POS_LENGTH  + MX_READ_DATA + MX_PRESENT_LOAD_L + MX_BYTE_READ_POS))&0xFF;
-    
+// Drives the direction pin with one syscall on the descriptor opened by begin(), or
+// through the sysfs value file when begin() could not keep it open
+void JetsonMX28::setDirection(int Mode)
+{
+    if(gpio_backend == GPIO_LINE)
+        gpioLineSetValue(gpio_fd, Mode);
+    else if(gpio_backend == GPIO_SYSFS)
+        gpioWriteValue(gpio_fd, Mode);
+    else
+        gpioSetValue(data, (pinValue)Mode);
+}
+
+/*
+    Sends every packet queued in tx_arena with one write(). On the GPIO UART the
+    direction pin is held in TX mode until tcdrain() reports them sent and their wire
+    time at the configured baud rate plus the guard time has passed.
+*/
+int JetsonMX28::transmit()
+{
+	if(rx_stale)
+	    discardInput();
+	
+	int Length = tx_used;
+	last_instruction = instructionIndex(tx_arena[tx_last + 4]);
+	last_servo = tx_arena[tx_last + 2];
+	
 	TRANSMIT_ON(gpio_status);
-    tx_buffer[0] = MX_START;
-    tx_buffer[1] = MX_START;
-    tx_buffer[2] = ID;
-    tx_buffer[3] = MX_POS_LENGTH;
-    tx_buffer[4] = MX_READ_DATA;
-    tx_buffer[5] = MX_PRESENT_LOAD_L;
-    tx_buffer[6] = MX_BYTE_READ_POS;
-    tx_buffer[7] = Checksum;
-    
-	count = write(uart0_filestream, &tx_buffer, 8);
+	
+	long long start = monotonicMicros();
+	int sent = 0;
+	count = 0;
+	while(sent < Length)
+	{
+	    count = ::write(uart0_filestream, &tx_arena[sent], Length - sent);
+	    if(count >= 0)
+	    {
+	        sent += count;
+	        continue;
+	    }
+	    if((errno != EAGAIN) & (errno != EINTR))
+	        break;
+	    
+	    // The GPIO UART is non blocking, wait for room in the driver
+	    struct pollfd room;
+	    room.fd = uart0_filestream;
+	    room.events = POLLOUT;
+	    poll(&room, 1, TIME_OUT);
+	}
 	if (count < 0)
 	{
 		printf("UART TX error\n");
+		statistics->TxErrors++;
+	}
+	else
+	{
+	    statistics->TxPackets += tx_packets;
+	    statistics->TxBytes += sent;
 	}
 	
-	usleep(TX_DELAY_TIME);
-	TRANSMIT_OFF(gpio_status);
+	// Only the last packet's status packet is waited for, earlier ones are dropped
+	if(tx_replies > 1)
+	    rx_stale = 1;
+	tx_used = tx_packets = tx_replies = 0;
+	tx_reserved = -1;
 
-    
-	Load_Byte = -1;
-	Time_Counter = 0;
-	while((bytesToRead() < 7) & (Time_Counter < TIME_OUT))
+	if(gpio_status)
 	{
-	    Time_Counter++;
-	    usleep(1000);
+	    tcdrain(uart0_filestream);
+	    long long drained = monotonicMicros();
+	    
+	    long long release = start + wireTime(Length) + ((turnaround_guard < 0) ? wireTime(1) : turnaround_guard);
+	    if(release > monotonicMicros())
+	    {
+	        struct timespec until;
+	        until.tv_sec = release / 1000000;
+	        until.tv_nsec = (release % 1000000) * 1000;
+	        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+	    }
+	    
+	    TRANSMIT_OFF(gpio_status);
+	    rx_reference = monotonicMicros();
+	    last_turnaround = rx_reference - start;
+	    
+	    if(stats_enabled)
+	    {
+	        statistics->Phase[last_instruction][MX_PHASE_TX].record(drained - start);
+	        statistics->Phase[last_instruction][MX_PHASE_TURNAROUND].record(rx_reference - drained);
+	        if(last_servo < MX_MAX_SERVOS)
+	        {
+	            statistics->Servo[last_servo][MX_PHASE_TX].record(drained - start);
+	            statistics->Servo[last_servo][MX_PHASE_TURNAROUND].record(rx_reference - drained);
+	        }
+	    }
 	}
-	
-	Read_Byte = 0;
-	Read_Byte = read(uart0_filestream, &rx_buffer, bytesToRead() );
-#if 0
-    printf("STUFF(%d): ", ret);
-    for(int i = 0; i < ret; i++)
-        printf("%d ", rx_buffer[i]);
-    printf("\n");
-#endif	
-	if(Read_Byte < 0)
+	else
 	{
-        printf("ERROR! NOTHING READ!\n");
+	    // No direction pin to wait for, the packets are still on the wire for a while
+	    rx_reference = monotonicMicros();
+	    if(rx_reference < start + wireTime(Length))
+	        rx_reference = start + wireTime(Length);
+	    if(stats_enabled)
+	    {
+	        statistics->Phase[last_instruction][MX_PHASE_TX].record(rx_reference - start);
+	        if(last_servo < MX_MAX_SERVOS)
+	            statistics->Servo[last_servo][MX_PHASE_TX].record(rx_reference - start);
+	    }
+	}
+	
+	return (count < 0) ? -1 : 0;
+}
+
+/*
+    Sends the queued packets and waits for the status packet of the last one when its
+    servo answers it, so it is never mistaken for a later reply. In a batch a packet
+    nobody answers stays queued, one that is answered ends the burst.
+    Returns 0, -1 if the status packet did not arrive or the negative error byte
+*/
+int JetsonMX28::command()
+{
+    const unsigned char *Packet = &tx_arena[tx_last];
+    unsigned char ID = Packet[2];
+    bool Answered = answers(ID, Packet[4]);
+    bool Written = (Packet[4] == MX_WRITE_DATA);
+    unsigned char Address = Packet[5];
+    int Length = Packet[3] - 3;
+
+    // A servo that was just given a new ID answers with it
+    if( (Packet[4] == MX_WRITE_DATA) & (Packet[5] == MX_ID) & (Packet[3] == MX_ID_LENGTH) )
+        ID = Packet[6];
+    
+    if(batching & !Answered)
+        return 0;
+    if(transmit() < 0)
+        return -1;
+    if(!Answered)
+        return 0;
+
+    MX28Packet Reply;
+    int Error = readPacket(ID, 0, &Reply);
+    if(Error < 0)
+        missed(ID);
+    
+    // The servo may not hold what the shadow assumed
+    if( (Error != 0) & Written )
+        forget(ID, Address, Length);
+    if(Error < 0)
         return -1;
+
+    return Error * (-1);
+}
+
+/*
+    True when ID sends a status packet for Instruction: PING always, READ_DATA from
+    status return level 1 and everything else at level 2. Broadcasts never get one.
+*/
+bool JetsonMX28::answers(unsigned char ID, unsigned char Instruction)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return false;
+    if(Instruction == MX_PING)
+        return true;
+    if(Instruction == MX_READ_DATA)
+        return return_level[ID] >= 1;
+
+    return return_level[ID] >= 2;
+}
+
+// Time in micro seconds to send Bytes bytes (start + 8 data + stop bits) at the configured baud rate
+long JetsonMX28::wireTime(int Bytes)
+{
+    return ((long long)Bytes * MX_BITS_PER_BYTE * 1000000 + baud_rate - 1) / baud_rate;
+}
+
+/*
+    Sets the extra time the direction pin stays in TX mode after the packet's wire time,
+    -1 (default) uses one byte time at the configured baud rate
+*/
+void JetsonMX28::setTurnaroundGuard(long Guard)
+{
+    turnaround_guard = Guard;
+}
+
+// Time in micro seconds from write() to releasing the direction pin on the last packet
+long JetsonMX28::turnaroundTime()
+{
+    return last_turnaround;
+}
+
+/*
+    Reads whatever bytes the UART has into rx_buffer, sleeping in ppoll() until the
+    first one arrives or the deadline passes. Decoded packets are only valid until
+    the next fill() since the buffer may be compacted.
+    Returns the number of bytes read, 0 at the deadline or -1 on a UART error
+*/
+int JetsonMX28::fill(long long Deadline)
+{
+    struct pollfd uart_poll;
+    struct timespec timeout;
+    
+    if(rx_head == rx_tail)
+    {
+        rx_head = rx_scan = rx_tail = 0;
     }
-    else
+    else if(MX_RX_BUFFER_SIZE - rx_tail < MX_BUFFER_SIZE)
+    {
+        memmove(rx_buffer, &rx_buffer[rx_head], rx_tail - rx_head);
+        rx_tail -= rx_head;
+        rx_scan -= rx_head;
+        rx_head = 0;
+    }
+    
+    uart_poll.fd = uart0_filestream;
+    uart_poll.events = POLLIN;
+    
+    while(1)
     {
-        for(int iter = 0; iter < (Read_Byte-1); iter++)
+        long long remaining = Deadline - monotonicMicros();
+        if(remaining <= 0)
+            return 0;
+        
+        timeout.tv_sec = remaining / 1000000;
+        timeout.tv_nsec = (remaining % 1000000) * 1000;
+        
+        int ready = ppoll(&uart_poll, 1, &timeout, NULL);
+        if(ready < 0)
         {
-            if( (rx_buffer[iter] == 255) & (rx_buffer[iter+1] == 255) )
-            {
-                if( (Error_Byte = rx_buffer[iter+4]) != 0 )
-                {
-                    printf("ERROR!\n");
-                    return (Error_Byte * (-1));
-                }
-                    
-                Load_Byte = rx_buffer[iter+5] + (rx_buffer[iter+6] << 8);
-                return Load_Byte;  
-            }
+            if(errno == EINTR)
+                continue;
+            printf("UART RX error\n");
+            return -1;
+        }
+        if(ready == 0)
+            return 0;
+        
+        int bytes = ::read(uart0_filestream, &rx_buffer[rx_tail], MX_RX_BUFFER_SIZE - rx_tail);
+        if(bytes < 0)
+        {
+            if((errno == EAGAIN) | (errno == EINTR))
+                continue;
+            printf("UART RX error\n");
+            return -1;
         }
+        
+        rx_tail += bytes;
+        statistics->RxBytes += bytes;
+        return bytes;
     }
-	    
-    return Load_Byte;
+}
+
+// Throws away everything received so far, including replies still in the UART driver
+void JetsonMX28::discardInput()
+{
+    tcflush(uart0_filestream, TCIFLUSH);
+    rx_head = rx_scan = rx_tail = 0;
+    rx_state = RX_HEADER_1;
+    rx_stale = 0;
 }
 
 int JetsonMX28::bytesToRead()
@@ -1416,4 +1533,898 @@ int JetsonMX28::bytesToRead()
     return bytes;
 }
 
+// Repeats a read request up to Retries more times when no valid reply arrives
+void JetsonMX28::setRetries(int Retries)
+{
+    read_retries = Retries;
+}
+
+// Turns the phase histograms on or off, the counters and response times are always kept
+void JetsonMX28::enableStats(bool Status)
+{
+    stats_enabled = Status;
+}
+
+const MX28Stats &JetsonMX28::stats()
+{
+    return *statistics;
+}
+
+void JetsonMX28::resetStats()
+{
+    memset(statistics, 0, sizeof(MX28Stats));
+    statistics->Since = monotonicMicros();
+}
+
+void JetsonMX28::printStats(FILE *Output)
+{
+    const MX28Stats &s = *statistics;
+    
+    fprintf(Output, "TX %lld packets %lld bytes %lld errors, RX %lld packets %lld bytes\n",
+            s.TxPackets, s.TxBytes, s.TxErrors, s.RxPackets, s.RxBytes);
+    fprintf(Output, "timeouts %lld checksum errors %lld framing errors %lld stale packets %lld retries %lld skipped %lld\n",
+            s.Timeouts, s.ChecksumErrors, s.FramingErrors, s.StalePackets, s.Retries, s.Skipped);
+    fprintf(Output, "suppressed writes %lld cache hits %lld, bus load %.1f%%\n", s.Suppressed, s.CacheHits, busLoad());
+    
+    for(int instruction = 0; instruction < MX_STAT_INSTRUCTIONS; instruction++)
+    {
+        for(int phase = 0; phase < MX_PHASES; phase++)
+        {
+            const MX28Histogram &h = s.Phase[instruction][phase];
+            if(h.Count == 0)
+                continue;
+            fprintf(Output, "%-10s %-10s n %u mean %ld p50 %ld p99 %ld max %ld us\n",
+                    instructionNames[instruction], phaseNames[phase], h.Count, h.mean(),
+                    h.percentile(50), h.percentile(99), h.Max);
+        }
+    }
+    
+    for(int ID = 0; ID < MX_MAX_SERVOS; ID++)
+    {
+        const MX28Histogram &h = s.Servo[ID][MX_PHASE_RESPONSE];
+        if( (h.Count == 0) & online(ID) )
+            continue;
+        fprintf(Output, "ID %-3d response n %u mean %ld p50 %ld p99 %ld max %ld us, timeout %ld us%s\n",
+                ID, h.Count, h.mean(), h.percentile(50), h.percentile(99), h.Max,
+                responseTimeout(ID), online(ID) ? "" : " offline");
+        
+        for(int phase = 0; phase < MX_PHASES; phase++)
+        {
+            const MX28Histogram &p = s.Servo[ID][phase];
+            if(p.Count == 0)
+                continue;
+            fprintf(Output, "       %-10s n %u mean %ld p50 %ld p99 %ld max %ld us\n",
+                    phaseNames[phase], p.Count, p.mean(), p.percentile(50), p.percentile(99), p.Max);
+        }
+    }
+}
 
+/*
+    Values below 16 get their own bucket, above that every power of 2 is split in
+    MX_HIST_SUB_BUCKETS equal buckets
+*/
+void MX28Histogram::record(long Value)
+{
+    if(Value < 0)
+        Value = 0;
+    
+    int bucket;
+    if(Value < 2 * MX_HIST_SUB_BUCKETS)
+        bucket = Value;
+    else
+    {
+        int shift = 0;
+        while((Value >> shift) >= 2 * MX_HIST_SUB_BUCKETS)
+            shift++;
+        bucket = (shift + 1) * MX_HIST_SUB_BUCKETS + (Value >> shift) - MX_HIST_SUB_BUCKETS;
+        if(bucket >= MX_HIST_BUCKETS)
+            bucket = MX_HIST_BUCKETS - 1;
+    }
+    
+    Buckets[bucket]++;
+    Count++;
+    Sum += Value;
+    if(Value > Max)
+        Max = Value;
+}
+
+// Smallest value at or below which Percentile (0-100) of the samples fall
+long MX28Histogram::percentile(double Percentile) const
+{
+    if(Count == 0)
+        return 0;
+    
+    long long target = (long long)(Count * Percentile / 100.0 + 0.5);
+    if(target < 1)
+        target = 1;
+    
+    long long seen = 0;
+    for(int bucket = 0; bucket < MX_HIST_BUCKETS; bucket++)
+    {
+        seen += Buckets[bucket];
+        if(seen < target)
+            continue;
+        
+        if(bucket < 2 * MX_HIST_SUB_BUCKETS)
+            return bucket;
+        if(bucket == MX_HIST_BUCKETS - 1)
+            return Max;                     // Overflow bucket
+        
+        int shift = bucket / MX_HIST_SUB_BUCKETS - 1;
+        long top = ((long)(bucket % MX_HIST_SUB_BUCKETS + MX_HIST_SUB_BUCKETS + 1) << shift) - 1;
+        return (top < Max) ? top : Max;
+    }
+    
+    return Max;
+}
+
+long MX28Histogram::mean() const
+{
+    return (Count == 0) ? 0 : (long)(Sum / Count);
+}
+
+void MX28Histogram::reset()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+/*
+    Waits for each servo's p99 response time plus Margin instead of the fixed
+    RX_TIMEOUT, once MX_TIMEOUT_SAMPLES replies of that servo have been timed
+    @Margin - micro seconds
+*/
+void JetsonMX28::setAdaptiveTimeout(bool Status, long Margin)
+{
+    adaptive_timeout = Status;
+    timeout_margin = Margin;
+    
+    for(int servo = 0; servo < MX_MAX_SERVOS; servo++)
+        links[servo].Timeout = 0;
+}
+
+// Micro seconds an offline servo is skipped before it is asked again
+void JetsonMX28::setOfflineRetry(long Period)
+{
+    offline_retry = Period;
+}
+
+// Micro seconds a read of ID waits for the status packet, not counting its length
+long JetsonMX28::responseTimeout(unsigned char ID)
+{
+    if( !adaptive_timeout || (ID >= MX_MAX_SERVOS) || (links[ID].Timeout == 0) )
+        return RX_TIMEOUT;
+    
+    return (links[ID].Timeout < RX_TIMEOUT) ? links[ID].Timeout : RX_TIMEOUT;
+}
+
+// False after MX_OFFLINE_MISSES timeouts in a row, until ID answers again
+bool JetsonMX28::online(unsigned char ID)
+{
+    return (ID >= MX_MAX_SERVOS) || (links[ID].Misses < MX_OFFLINE_MISSES);
+}
+
+// Forgets the response times and offline servos, e.g. after servos were rewired
+void JetsonMX28::resetTimeouts()
+{
+    memset(links, 0, sizeof(MX28Link) * MX_MAX_SERVOS);
+}
+
+// Sets any UART baud rate with BOTHER, the driver picks the closest rate it can make
+int JetsonMX28::setLineBaud(long Baud)
+{
+    struct MX28Termios2 options;
+    
+    if(ioctl(uart0_filestream, MX_TCGETS2, &options) < 0)
+    {
+        printf("UART error: termios2 not supported\n");
+        return -1;
+    }
+    
+    options.c_cflag &= ~(CBAUD | (CBAUD << MX_IBSHIFT));
+    options.c_cflag |= MX_BOTHER | (MX_BOTHER << MX_IBSHIFT);
+    options.c_ispeed = Baud;
+    options.c_ospeed = Baud;
+    
+    if(ioctl(uart0_filestream, MX_TCSETS2, &options) < 0)
+    {
+        printf("UART error: %ld bps not supported\n", Baud);
+        return -1;
+    }
+    
+    return 0;
+}
+
+/*
+    Changes the baud rate of the open UART, the servos are not changed
+    @Baud - bits per second, e.g. 1000000 or 2250000
+*/
+int JetsonMX28::setBaudRate(long Baud)
+{
+    tcdrain(uart0_filestream);
+    if(setLineBaud(Baud) < 0)
+        return -1;
+    
+    baud_rate = Baud;
+    resetTimeouts();
+    discardInput();
+    
+    return 0;
+}
+
+long JetsonMX28::baudRate()
+{
+    return baud_rate;
+}
+
+/*
+    Moves the servos in IDs and the UART to a new baud rate.
+    Every servo must answer at the current rate first, then all of them are
+    changed with one SYNC_WRITE and read back at the new rate. If any servo does
+    not answer there, the servos that did change are put back and the UART
+    returns to the old rate.
+    @IDs - every servo on the bus
+    @Count - number of servos
+    @Baud - bits per second, 2000000/(n + 1) or 2250000, 2500000, 3000000
+    Returns 0 or -1 with the bus left at the old rate
+*/
+int JetsonMX28::switchBaudRate(const unsigned char *IDs, int Count, long Baud)
+{
+    int BD = baudRegister(Baud);
+    if( (BD < 0) | (Count <= 0) | (Count > MX_MAX_BULK) )
+    {
+        printf("BAUD SWITCH error: bad baud rate or servo count\n");
+        return -1;
+    }
+    
+    MX28Packet Packet;
+    unsigned char Data[MX_MAX_BULK];
+    unsigned char Old_BD = 0;
+    long Old_Baud = baud_rate;
+    
+    // A servo that misses the switch would be left behind on the old rate. The servos
+    // are asked, the read cache only knows what the library last wrote.
+    for(int servo = 0; servo < Count; servo++)
+    {
+        if(readData(IDs[servo], MX_BAUD_RATE, MX_BYTE_READ, &Packet, false) != 0)
+        {
+            printf("BAUD SWITCH error: ID %d does not answer\n", IDs[servo]);
+            return -1;
+        }
+        Old_BD = Packet.Params[0];
+    }
+    
+    memset(Data, BD, Count);
+    syncWrite(MX_BAUD_RATE, 1, IDs, Data, Count);
+    tcdrain(uart0_filestream);
+    usleep(MX_BAUD_SETTLE);
+    setBaudRate(Baud);
+    
+    int Missing = 0;
+    for(int servo = 0; servo < Count; servo++)
+    {
+        if( (readData(IDs[servo], MX_BAUD_RATE, MX_BYTE_READ, &Packet, false) != 0) || (Packet.Params[0] != BD) )
+            Missing++;
+    }
+    if(Missing == 0)
+        return 0;
+    
+    // The servos that did not switch are still on the old rate
+    memset(Data, Old_BD, Count);
+    syncWrite(MX_BAUD_RATE, 1, IDs, Data, Count);
+    tcdrain(uart0_filestream);
+    usleep(MX_BAUD_SETTLE);
+    setBaudRate(Old_Baud);
+    
+    printf("BAUD SWITCH error: %d servos did not answer at %ld bps, bus back at %ld bps\n", Missing, Baud, Old_Baud);
+    return -1;
+}
+
+// sysfs latency timer of the USB UART, e.g. /sys/bus/usb-serial/devices/ttyUSB0/latency_timer
+int JetsonMX28::latencyPath(char *Path, int Size)
+{
+    char Device[PATH_MAX];
+    
+    // Follows links like /dev/serial/by-id/usb-FTDI_...
+    if(realpath(uart_path, Device) == NULL)
+        return -1;
+    
+    const char *Name = strrchr(Device, '/');
+    snprintf(Path, Size, MX_LATENCY_PATH, (Name == NULL) ? Device : Name + 1);
+    
+    return access(Path, F_OK);
+}
+
+/*
+    Sets the USB UART to low latency mode and its FTDI latency timer, the timer
+    needs write access to sysfs (root or a udev rule)
+    @Milliseconds - 1 to 255
+    Returns 0 or -1 if the latency could not be lowered, see usbLatency()
+*/
+int JetsonMX28::setUSBLatency(int Milliseconds)
+{
+    int Status = -1;
+    
+    struct serial_struct serial;
+    if(ioctl(uart0_filestream, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if(ioctl(uart0_filestream, TIOCSSERIAL, &serial) == 0)
+            Status = 0;
+    }
+    
+    char Path[PATH_MAX];
+    usb_latency = -1;
+    if(latencyPath(Path, sizeof(Path)) < 0)
+        return Status;          // Not an FTDI adapter
+    
+    FILE *Timer = fopen(Path, "w");
+    if(Timer != NULL)
+    {
+        fprintf(Timer, "%d", Milliseconds);
+        if(fclose(Timer) != 0)
+            Status = -1;
+    }
+    else
+    {
+        printf("USB UART error: no write access to %s\n", Path);
+        Status = -1;
+    }
+    
+    int Latency;
+    Timer = fopen(Path, "r");
+    if(Timer != NULL)
+    {
+        if(fscanf(Timer, "%d", &Latency) == 1)
+        {
+            usb_latency = Latency * 1000L;
+            if(Latency > Milliseconds)
+                Status = -1;
+        }
+        fclose(Timer);
+    }
+    
+    return Status;
+}
+
+// Latency timer of the USB UART in micro seconds, -1 if it has none or it can not be read
+long JetsonMX28::usbLatency()
+{
+    return usb_latency;
+}
+
+// Status return level the library assumes for ID, see setSRL() and readSRL()
+int JetsonMX28::returnLevel(unsigned char ID)
+{
+    return (ID < MX_MAX_SERVOS) ? return_level[ID] : 0;
+}
+
+// Reads the status return level of ID from the servo, never the cache, the library uses it from then on
+int JetsonMX28::readSRL(unsigned char ID)
+{
+    // The level is unknown, a read must be tried even if it was set to 0
+    if( (ID < MX_MAX_SERVOS) && (return_level[ID] == 0) )
+        return_level[ID] = 1;
+
+    int Level = readValue(ID, MX_RETURN_LEVEL, MX_BYTE_READ, false);
+    if( (Level < 0) & (ID < MX_MAX_SERVOS) )
+        return_level[ID] = 0;
+
+    return Level;
+}
+
+/*
+    Reserves room for an instruction packet with Params parameter bytes at the end of
+    the TX arena, the queued packets are sent first when it is full. Fill in the
+    parameters, then commit() the packet. Nothing is zeroed or allocated.
+    Returns where the parameters go, NULL if they do not fit in one packet
+*/
+unsigned char *JetsonMX28::reserve(int Params)
+{
+    if( (Params < 0) | (Params + 2 > MX_MAX_PACKET_LENGTH) )
+    {
+        printf("TX error: %d parameters do not fit in one packet\n", Params);
+        return NULL;
+    }
+    
+    if(tx_used + Params + MX_PACKET_OVERHEAD > MX_TX_ARENA_SIZE)
+        flush();
+    
+    tx_reserved = Params;
+    return &tx_arena[tx_used + 5];
+}
+
+/*
+    Adds the header and checksum around the parameters of the last reserve() and queues
+    the packet. Status packets to queued packets are not read, see flush().
+    @Params - parameter bytes written, at most what was reserved
+    Returns 0 or -1 without a matching reservation
+*/
+int JetsonMX28::commit(unsigned char ID, unsigned char Instruction, int Params)
+{
+    if( (Params < 0) | (Params > tx_reserved) )
+    {
+        printf("TX error: %d parameters were not reserved\n", Params);
+        return -1;
+    }
+    
+    unsigned char *Packet = &tx_arena[tx_used];
+    unsigned char Sum = ID + Params + 2 + Instruction;
+    
+    Packet[0] = MX_START;
+    Packet[1] = MX_START;
+    Packet[2] = ID;
+    Packet[3] = Params + 2;
+    Packet[4] = Instruction;
+    for(int i = 0; i < Params; i++)
+        Sum += Packet[5 + i];
+    Packet[5 + Params] = ~Sum;
+    
+    queue(Params + MX_PACKET_OVERHEAD);
+    return 0;
+}
+
+// Queues the Length byte packet just written at the end of the TX arena
+void JetsonMX28::queue(int Length)
+{
+    tx_last = tx_used;
+    tx_used += Length;
+    tx_packets++;
+    tx_reserved = -1;
+    
+    if(shadow_enabled | cache_enabled)
+        track(&tx_arena[tx_last]);
+
+    if(answers(tx_arena[tx_last + 2], tx_arena[tx_last + 4]))
+        tx_replies++;
+}
+
+/*
+    Sends every committed packet back to back with one write() and one direction pin
+    toggle. Status packets they cause are dropped, so packets to servos that answer
+    (status return level 2, or 1 for READ_DATA) are better sent through the library calls.
+    Returns 0 or -1 on a UART error
+*/
+int JetsonMX28::flush()
+{
+    if(tx_used == 0)
+        return 0;
+    
+    int Replies = tx_replies;
+    int Error = transmit();
+    if(Replies > 0)
+        rx_stale = 1;
+    
+    return Error;
+}
+
+// Bytes committed to the TX arena and not sent yet
+int JetsonMX28::queued()
+{
+    return tx_used;
+}
+
+/*
+    Starts queueing the library's instruction packets instead of sending each one.
+    Packets without a status packet (writes at status return level 0 or 1, broadcasts,
+    SYNC_WRITE, ACTION) go out back to back under one direction pin toggle at endBatch().
+    A packet that is answered, like a read, sends the burst with itself as the last
+    packet so its status packet can not collide with the ones after it.
+*/
+void JetsonMX28::beginBatch()
+{
+    batching = 1;
+}
+
+/*
+    Sends what the batch queued, including the shadow's dirty bytes
+    Returns 0, -1 on a UART error or a missing status packet or the negative error byte
+*/
+int JetsonMX28::endBatch()
+{
+    int Error = writeDirty();
+    batching = 0;
+    
+    return (flush() < 0) ? -1 : Error;
+}
+
+/*
+    Keeps a shadow of every servo's control table from what the library wrote and read.
+    Writes of values the shadow already holds are skipped, and in a batch the changed
+    bytes are only marked dirty and sent by endBatch() in as few WRITE_DATA packets as
+    possible. Turning it on or off starts with an empty shadow.
+*/
+void JetsonMX28::enableShadow(bool Status)
+{
+    writeDirty();
+    memset(shadow_valid, 0, sizeof(shadow_valid));
+    memset(shadow_dirty, 0, sizeof(shadow_dirty));
+    shadow_enabled = Status;
+}
+
+/*
+    Serves reads from the shadow control table while the values are fresh, see
+    setCacheTime(). Cache hits never touch the UART and are counted in stats().
+    Values changed outside the library are only seen after invalidate() or refresh().
+*/
+void JetsonMX28::enableCache(bool Status)
+{
+    // Nothing kept the shadow up to date while both were off
+    if(!shadow_enabled & !cache_enabled)
+    {
+        memset(shadow_valid, 0, sizeof(shadow_valid));
+        memset(shadow_dirty, 0, sizeof(shadow_dirty));
+    }
+    cache_enabled = Status;
+}
+
+/*
+    How long reads of Length bytes from Address may be served from the cache
+    @Time - micro seconds, MX_CACHE_UNTIL_WRITTEN or MX_CACHE_NEVER
+    By default EEPROM is kept until written, the present temperature for
+    MX_TEMPERATURE_TTL, the present voltage for MX_VOLTAGE_TTL and the rest is never cached.
+*/
+void JetsonMX28::setCacheTime(unsigned char Address, int Length, long Time)
+{
+    for(int address = Address; (address < Address + Length) & (address < MX_TABLE_SIZE); address++)
+        cache_time[address] = Time;
+}
+
+// True when every byte of the read is in the shadow and fresh enough
+bool JetsonMX28::cached(unsigned char ID, unsigned char Address, int Length)
+{
+    if( !cache_enabled | (ID >= MX_MAX_SERVOS) | (Address + Length > MX_TABLE_SIZE) )
+        return false;
+    
+    long long now = monotonicMicros();
+    for(int address = Address; address < Address + Length; address++)
+    {
+        if( !(shadow_valid[ID] & (1ULL << address)) | (cache_time[address] == MX_CACHE_NEVER) )
+            return false;
+        if( (cache_time[address] > 0) && (now - shadow_time[ID][address] > cache_time[address]) )
+            return false;
+    }
+    
+    return true;
+}
+
+/*
+    Goal positions and speeds within these steps of the shadow are not written
+    @Position - steps of MX_GOAL_POSITION, 0 to write every change
+    @Speed    - steps of MX_GOAL_SPEED, 0 to write every change
+*/
+void JetsonMX28::setDeadband(int Position, int Speed)
+{
+    position_deadband = Position;
+    speed_deadband = Speed;
+}
+
+/*
+    Reads the whole control table of ID into the shadow, e.g. after a servo was reset
+    or power cycled behind the library's back. Dirty bytes are kept.
+    Returns 0, -1 if nothing was read or the negative error byte
+*/
+int JetsonMX28::refresh(unsigned char ID)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return -1;
+    
+    forget(ID, 0, MX_TABLE_SIZE);
+    
+    MX28Packet Packet;
+    int Error = readData(ID, 0, MX_TABLE_SIZE, &Packet, false);
+    if(Error < 0)
+        return -1;
+    
+    return Error * (-1);
+}
+
+// Drops what the shadow holds for ID, every servo for BROADCAST_ID
+void JetsonMX28::invalidate(unsigned char ID)
+{
+    forget(ID, 0, MX_TABLE_SIZE);
+    
+    if(ID < MX_MAX_SERVOS)
+        shadow_dirty[ID] = 0;
+    else
+        memset(shadow_dirty, 0, sizeof(shadow_dirty));
+}
+
+/*
+    Sends the dirty bytes of every servo. Runs closer together than a packet's overhead
+    are joined by rewriting the RAM bytes between them, so each servo gets the fewest
+    contiguous WRITE_DATA packets.
+    Returns 0, -1 or the negative error byte of the last failed write
+*/
+int JetsonMX28::writeDirty()
+{
+    int Error = 0;
+    
+    for(int ID = 0; ID < MX_MAX_SERVOS; ID++)
+    {
+        while(shadow_dirty[ID])
+        {
+            unsigned long long dirty = shadow_dirty[ID];
+            int First = __builtin_ctzll(dirty);
+            int Last = First;
+            
+            for(int address = First + 1; address < MX_TABLE_SIZE; )
+            {
+                if(dirty & (1ULL << address))
+                {
+                    Last = address++;
+                    continue;
+                }
+                
+                // Clean bytes are only rewritten from RAM the shadow holds
+                int next = address;
+                while( (next < MX_TABLE_SIZE) && !(dirty & (1ULL << next)) && rewritable(next) && (shadow_valid[ID] & (1ULL << next)) )
+                    next++;
+                if( (next == MX_TABLE_SIZE) || !(dirty & (1ULL << next)) || (next - address > MX_WRITE_OVERHEAD) )
+                    break;
+                
+                Last = next;
+                address = next + 1;
+            }
+            
+            int Length = Last - First + 1;
+            shadow_dirty[ID] &= ~(((1ULL << Length) - 1) << First);
+            
+            unsigned char *Params = reserve(Length + 1);
+            Params[0] = First;
+            memcpy(&Params[1], &shadow[ID][First], Length);
+            commit(ID, MX_WRITE_DATA, Length + 1);
+            
+            int Result = command();
+            if(Result != 0)
+                Error = Result;
+        }
+    }
+    
+    return Error;
+}
+
+/*
+    Checks every writable register inside Length bytes from Address against its range,
+    the same check write<Reg>() does for one register
+    Returns 0 or -MX_ERROR_RANGE if a value is out of range
+*/
+int JetsonMX28::checkRange(unsigned char Address, const unsigned char *Data, int Length)
+{
+    for(unsigned int i = 0; i < sizeof(writableLimits) / sizeof(writableLimits[0]); i++)
+    {
+        const MX28Limit &Reg = writableLimits[i];
+        if( (Reg.Address < Address) | (Reg.Address + Reg.Width > Address + Length) )
+            continue;
+        
+        int Value = Data[Reg.Address - Address];
+        if(Reg.Width == 2)
+            Value += Data[Reg.Address - Address + 1] << 8;
+        
+        if( (Value < Reg.Min) | (Value > Reg.Max) )
+        {
+            printf("RANGE error: %d is not in %d to %d\n", Value, Reg.Min, Reg.Max);
+            return -MX_ERROR_RANGE;
+        }
+    }
+    
+    return 0;
+}
+
+/*
+    Decides if a WRITE_DATA must be sent. Values the shadow already holds, or goal values
+    within the deadband, are skipped. In a batch the changed bytes are marked dirty
+    for writeDirty() instead.
+    Returns true when the packet has to be sent now
+*/
+bool JetsonMX28::shadowWrite(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    if( !shadow_enabled | (ID >= MX_MAX_SERVOS) | (Address + Length > MX_TABLE_SIZE) )
+        return true;
+    
+    unsigned char Value[MX_TABLE_SIZE];
+    memcpy(Value, Data, Length);
+    deadband(ID, Address, Value, Length, MX_GOAL_POSITION_L, position_deadband);
+    deadband(ID, Address, Value, Length, MX_GOAL_SPEED_L, speed_deadband);
+    
+    unsigned long long changed = 0;
+    for(int i = 0; i < Length; i++)
+    {
+        unsigned long long bit = 1ULL << (Address + i);
+        if( !(shadow_valid[ID] & bit) || (shadow[ID][Address + i] != Value[i]) )
+            changed |= bit;
+    }
+    
+    if(changed == 0)
+    {
+        statistics->Suppressed++;
+        return false;
+    }
+    if(!batching)
+        return true;
+    
+    for(int i = 0; i < Length; i++)
+    {
+        if(changed & (1ULL << (Address + i)))
+            shadow[ID][Address + i] = Value[i];
+    }
+    shadow_valid[ID] |= changed;
+    shadow_dirty[ID] |= changed;
+    
+    return false;
+}
+
+// Replaces a 2 byte goal value in Data by the shadow's when they are within Band steps
+void JetsonMX28::deadband(unsigned char ID, unsigned char Address, unsigned char *Data, int Length, unsigned char Register, int Band)
+{
+    unsigned long long bits = 3ULL << Register;
+    if( (Band <= 0) | (Register < Address) | (Register + 2 > Address + Length) || ((shadow_valid[ID] & bits) != bits) )
+        return;
+    
+    int offset = Register - Address;
+    int Wanted = Data[offset] + (Data[offset + 1] << 8);
+    int Known = shadow[ID][Register] + (shadow[ID][Register + 1] << 8);
+    
+    if(abs(Wanted - Known) <= Band)
+    {
+        Data[offset] = shadow[ID][Register];
+        Data[offset + 1] = shadow[ID][Register + 1];
+    }
+}
+
+// Updates the shadow from an instruction packet that is about to be sent
+void JetsonMX28::track(const unsigned char *Packet)
+{
+    unsigned char ID = Packet[2];
+    
+    switch(Packet[4])
+    {
+        case MX_WRITE_DATA:
+            if(ID < MX_MAX_SERVOS)
+                learn(ID, Packet[5], &Packet[6], Packet[3] - 3);
+            else
+                forget(ID, Packet[5], Packet[3] - 3);
+            break;
+            
+        case MX_SYNC_WRITE:
+        {
+            int Length = Packet[6];
+            const unsigned char *Block = &Packet[7];
+            for(int servo = (Packet[3] - MX_SYNC_WRITE_LENGTH) / (Length + 1); servo > 0; servo--, Block += Length + 1)
+                learn(Block[0], Packet[5], &Block[1], Length);
+            break;
+        }
+        
+        case MX_REG_WRITE:
+            // The registers change at ACTION, until then the shadow does not know them
+            forget(ID, Packet[5], Packet[3] - 3);
+            break;
+    }
+}
+
+// Stores bytes the servo holds in the shadow, bytes waiting in a batch are kept
+void JetsonMX28::learn(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    if( (ID >= MX_MAX_SERVOS) | (Address + Length > MX_TABLE_SIZE) )
+        return;
+    
+    long long now = monotonicMicros();
+    for(int i = 0; i < Length; i++)
+    {
+        unsigned long long bit = 1ULL << (Address + i);
+        if(shadow_dirty[ID] & bit)
+            continue;
+        shadow[ID][Address + i] = Data[i];
+        shadow_time[ID][Address + i] = now;
+        shadow_valid[ID] |= bit;
+    }
+}
+
+// Marks Length bytes from Address unknown on ID, on every servo for BROADCAST_ID
+void JetsonMX28::forget(unsigned char ID, unsigned char Address, int Length)
+{
+    if(Address >= MX_TABLE_SIZE)
+        return;
+    if(Address + Length > MX_TABLE_SIZE)
+        Length = MX_TABLE_SIZE - Address;
+    
+    unsigned long long bits = ((1ULL << Length) - 1) << Address;
+    for(int servo = 0; servo < MX_MAX_SERVOS; servo++)
+    {
+        if( (ID == BROADCAST_ID) | (servo == ID) )
+            shadow_valid[servo] &= ~bits;
+    }
+}
+
+/*
+    Predicts how long the bus needs for one cycle of Load in micro seconds, from the
+    packet sizes the library builds, the baud rate, the return delay, the direction
+    pin guard time on the GPIO UART, the latency timer on a USB UART and the host
+    overhead per transaction. E.g. 16 servos read with BULK_READ and moved with
+    SYNC_WRITE:
+        MX28Workload Load = {0, 0, 0, 0, false, 16, 2, 16, MX_STATE_LENGTH, 0};
+        bus.predictLoad(Load, 300);
+    Returns -1 when a SYNC_WRITE servo's data does not fit in a packet
+*/
+long JetsonMX28::predictCycle(const MX28Workload &Load)
+{
+    long Delay = (Load.ReturnDelay < 0) ? return_delay : Load.ReturnDelay;
+    long Time = 0;
+    
+    int per_sync = (Load.SyncLength < 0) ? 0 : (MX_MAX_PACKET_LENGTH - MX_SYNC_WRITE_LENGTH) / (Load.SyncLength + 1);
+    if( (Load.SyncServos > 0) & (per_sync <= 0) )
+    {
+        printf("MODEL error: SYNC_WRITE of %d bytes per servo does not fit in a packet\n", Load.SyncLength);
+        return -1;
+    }
+    
+    Time += Load.Reads * transactionTime(MX_READ_LENGTH + 4, 1, Load.ReadLength, Delay);
+    Time += Load.Writes * transactionTime(Load.WriteLength + MX_WRITE_OVERHEAD, Load.Acknowledged ? 1 : 0, 0, Delay);
+    
+    // Large groups need several packets
+    for(int first = 0; first < Load.SyncServos; first += per_sync)
+    {
+        int count = (Load.SyncServos - first < per_sync) ? (Load.SyncServos - first) : per_sync;
+        Time += transactionTime((Load.SyncLength + 1) * count + MX_SYNC_WRITE_LENGTH + 4, 0, 0, Delay);
+    }
+    
+    for(int first = 0; first < Load.BulkServos; first += MX_MAX_BULK)
+    {
+        int count = (Load.BulkServos - first < MX_MAX_BULK) ? (Load.BulkServos - first) : MX_MAX_BULK;
+        Time += transactionTime(count * MX_BULK_READ_LENGTH + MX_BULK_READ_LENGTH + 4, count, Load.BulkLength, Delay);
+    }
+    
+    return Time;
+}
+
+// Percent of the bus time Load takes when it runs Rate times per second, -1 for a bad Load
+double JetsonMX28::predictLoad(const MX28Workload &Load, double Rate)
+{
+    long Time = predictCycle(Load);
+    return (Time < 0) ? -1 : Time * Rate / 10000.0;
+}
+
+// Highest rate in Hz Load can run at without filling the bus
+double JetsonMX28::maxRate(const MX28Workload &Load)
+{
+    long Time = predictCycle(Load);
+    return (Time > 0) ? 1000000.0 / Time : 0;
+}
+
+// Micro seconds of syscalls and thread wake-ups the model adds to each transaction
+void JetsonMX28::setHostOverhead(long Overhead)
+{
+    host_overhead = Overhead;
+}
+
+/*
+    Time for one request of TxBytes and Replies status packets with ReplyLength
+    parameters each, the servos answer one after the other
+*/
+long JetsonMX28::transactionTime(int TxBytes, int Replies, int ReplyLength, long ReturnDelay)
+{
+    long Time = host_overhead + wireTime(TxBytes);
+    
+    if(gpio_status)
+        Time += (turnaround_guard < 0) ? wireTime(1) : turnaround_guard;
+    
+    if(Replies > 0)
+    {
+        Time += Replies * (ReturnDelay + wireTime(ReplyLength + MX_STATUS_LENGTH));
+        
+        // The adapter holds the last bytes until its latency timer runs out
+        if(!gpio_status & (usb_latency > 0))
+            Time += usb_latency;
+    }
+    
+    return Time;
+}
+
+// Measured share of the time since resetStats() the wire carried bytes, in percent
+double JetsonMX28::busLoad()
+{
+    long long elapsed = monotonicMicros() - statistics->Since;
+    if(elapsed <= 0)
+        return 0;
+    
+    return (statistics->TxBytes + statistics->RxBytes) * MX_BITS_PER_BYTE * 100000000.0 / baud_rate / elapsed;
+}
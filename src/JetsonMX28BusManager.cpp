@@ -0,0 +1,264 @@
+/*
+********************************************************************************************
+    Multi-bus manager for the JetsonMX28 library
+    
+    MODIFICATIONS:
+    10/17/2026 - Created the bus manager
+    10/17/2026 - Broadcast writes and emergencyStop() on every bus
+    10/17/2026 - addBus() fails when the bus can not be opened
+    
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#include "JetsonMX28BusManager.h"
+
+JetsonMX28BusManager::JetsonMX28BusManager()
+{
+    bus_count = 0;
+    for(int ID = 0; ID < MX_MAX_SERVOS; ID++)
+        routes[ID] = MX_NO_BUS;
+}
+
+JetsonMX28BusManager::~JetsonMX28BusManager()
+{
+    stop();
+    
+    for(int index = 0; index < bus_count; index++)
+    {
+        delete engines[index];
+        buses[index]->disconnect();
+        delete buses[index];
+    }
+}
+
+// Takes over a bus set up with begin() and returns its index
+int JetsonMX28BusManager::add(JetsonMX28 *Bus)
+{
+    buses[bus_count] = Bus;
+    engines[bus_count] = new JetsonMX28Engine(*Bus);
+    
+    return bus_count++;
+}
+
+// Adds a USB UART bus, returns its index or -1
+int JetsonMX28BusManager::addBus(const char *stream, speed_t baud)
+{
+    if(bus_count == MX_MAX_BUSES)
+        return -1;
+    
+    JetsonMX28 *Bus = new JetsonMX28;
+    if(Bus->begin(stream, baud) < 0)
+    {
+        delete Bus;
+        return -1;
+    }
+    
+    return add(Bus);
+}
+
+// Adds a GPIO UART bus with a sysfs direction pin, returns its index or -1
+int JetsonMX28BusManager::addBus(const char *stream, speed_t baud, jetsonGPIO dataPin)
+{
+    if(bus_count == MX_MAX_BUSES)
+        return -1;
+    
+    JetsonMX28 *Bus = new JetsonMX28;
+    if(Bus->begin(stream, baud, dataPin) < 0)
+    {
+        delete Bus;
+        return -1;
+    }
+    
+    return add(Bus);
+}
+
+// Adds a GPIO UART bus with a GPIO character device direction pin, returns its index or -1
+int JetsonMX28BusManager::addBus(const char *stream, speed_t baud, const char *gpioChip, unsigned int line)
+{
+    if(bus_count == MX_MAX_BUSES)
+        return -1;
+    
+    JetsonMX28 *Bus = new JetsonMX28;
+    if(Bus->begin(stream, baud, gpioChip, line) < 0)
+    {
+        delete Bus;
+        return -1;
+    }
+    
+    return add(Bus);
+}
+
+/*
+    Routes ID to a bus and reads its state there every cycle, MX_NO_BUS removes the route.
+    Assign servos before start(), the routing table is not locked.
+*/
+int JetsonMX28BusManager::assign(unsigned char ID, int Bus)
+{
+    if( (ID >= MX_MAX_SERVOS) | (Bus >= bus_count) | (Bus < MX_NO_BUS) )
+        return -1;
+    
+    if(routes[ID] != MX_NO_BUS)
+        engines[routes[ID]]->watch(ID, OFF);
+    
+    routes[ID] = Bus;
+    if(Bus != MX_NO_BUS)
+        engines[Bus]->watch(ID, ON);
+    
+    return 0;
+}
+
+// Returns the bus ID is routed to or MX_NO_BUS
+int JetsonMX28BusManager::route(unsigned char ID)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return MX_NO_BUS;
+    
+    return routes[ID];
+}
+
+// Starts one engine thread per bus
+int JetsonMX28BusManager::start(long Period)
+{
+    for(int index = 0; index < bus_count; index++)
+    {
+        if(engines[index]->start(Period) < 0)
+            return -1;
+    }
+    
+    return 0;
+}
+
+void JetsonMX28BusManager::stop()
+{
+    for(int index = 0; index < bus_count; index++)
+        engines[index]->stop();
+}
+
+int JetsonMX28BusManager::write(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    int Bus = route(ID);
+    if(Bus == MX_NO_BUS)
+        return -1;
+    
+    return engines[Bus]->write(ID, Address, Data, Length);
+}
+
+int JetsonMX28BusManager::move(unsigned char ID, int Position)
+{
+    int Bus = route(ID);
+    if(Bus == MX_NO_BUS)
+        return -1;
+    
+    return engines[Bus]->move(ID, Position);
+}
+
+int JetsonMX28BusManager::moveSpeed(unsigned char ID, int Position, int Speed)
+{
+    int Bus = route(ID);
+    if(Bus == MX_NO_BUS)
+        return -1;
+    
+    return engines[Bus]->moveSpeed(ID, Position, Speed);
+}
+
+int JetsonMX28BusManager::torqueStatus(unsigned char ID, bool Status)
+{
+    int Bus = route(ID);
+    if(Bus == MX_NO_BUS)
+        return -1;
+    
+    return engines[Bus]->torqueStatus(ID, Status);
+}
+
+/*
+    Queues goal positions for servos on any bus, each engine sends its share as one
+    SYNC_WRITE on its next cycle
+    Returns 0 or -1 if a servo is not routed or a queue was full
+*/
+int JetsonMX28BusManager::syncMove(const unsigned char *IDs, const int *Positions, int Count)
+{
+    int Result = 0;
+    
+    for(int servo = 0; servo < Count; servo++)
+    {
+        if(move(IDs[servo], Positions[servo]) < 0)
+            Result = -1;
+    }
+    
+    return Result;
+}
+
+int JetsonMX28BusManager::syncMoveSpeed(const unsigned char *IDs, const int *Positions, const int *Speeds, int Count)
+{
+    int Result = 0;
+    
+    for(int servo = 0; servo < Count; servo++)
+    {
+        if(moveSpeed(IDs[servo], Positions[servo], Speeds[servo]) < 0)
+            Result = -1;
+    }
+    
+    return Result;
+}
+
+// Queues a broadcast write on every bus, each sends it as one packet on its next cycle
+int JetsonMX28BusManager::writeAll(unsigned char Address, const unsigned char *Data, int Length)
+{
+    int Result = 0;
+    
+    for(int index = 0; index < bus_count; index++)
+    {
+        if(engines[index]->writeAll(Address, Data, Length) < 0)
+            Result = -1;
+    }
+    
+    return Result;
+}
+
+int JetsonMX28BusManager::torqueAll(bool Status)
+{
+    unsigned char Data = Status;
+    
+    return writeAll(MX_TORQUE_ENABLE, &Data, 1);
+}
+
+// Turns the torque off on every bus at once, ahead of the commands queued on them
+int JetsonMX28BusManager::emergencyStop()
+{
+    int Result = 0;
+    
+    for(int index = 0; index < bus_count; index++)
+    {
+        if(engines[index]->emergencyStop() < 0)
+            Result = -1;
+    }
+    
+    return Result;
+}
+
+int JetsonMX28BusManager::readState(unsigned char ID, MX28State *State, long long *Stamp)
+{
+    int Bus = route(ID);
+    if(Bus == MX_NO_BUS)
+        return -1;
+    
+    return engines[Bus]->readState(ID, State, Stamp);
+}
+
+JetsonMX28 *JetsonMX28BusManager::bus(int Bus)
+{
+    return ( (Bus < 0) | (Bus >= bus_count) ) ? NULL : buses[Bus];
+}
+
+JetsonMX28Engine *JetsonMX28BusManager::engine(int Bus)
+{
+    return ( (Bus < 0) | (Bus >= bus_count) ) ? NULL : engines[Bus];
+}
+
+int JetsonMX28BusManager::busCount()
+{
+    return bus_count;
+}
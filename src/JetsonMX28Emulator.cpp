@@ -0,0 +1,680 @@
+/*
+********************************************************************************************
+    Virtual MX-28 servos for the JetsonMX28 library
+
+    MODIFICATIONS:
+    10/17/2026 - Created the emulator
+    10/17/2026 - Status packets are sent from an outbox instead of sleeping per reply
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#include "JetsonMX28Emulator.h"
+#include <stdlib.h>
+
+static long long monotonicMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// Baud rate in bits per second of a servo baud rate register value
+static long servoBaud(int BD)
+{
+    switch(BD)
+    {
+        case 250: return 2250000;
+        case 251: return 2500000;
+        case 252: return 3000000;
+        default:  return 2000000 / (BD + 1);
+    }
+}
+
+JetsonMX28Emulator::JetsonMX28Emulator()
+{
+    master_fd = -1;
+    slave_fd = -1;
+    slave_path[0] = 0;
+    rx_count = 0;
+    outbox_count = 0;
+    line_baud = 0;
+    bus_free = 0;
+    last_update = 0;
+    packet_count = 0;
+    seed = 1;
+    running = false;
+
+    memset(&faults, 0, sizeof(faults));
+    for(int ID = 0; ID < MX_MAX_SERVOS; ID++)
+        servos[ID].Present = false;
+}
+
+JetsonMX28Emulator::~JetsonMX28Emulator()
+{
+    disconnect();
+}
+
+/*
+    Opens the pseudo terminal and adds Servos virtual servos
+    @Servos - number of servos
+    @FirstID - ID of the first servo, the others follow
+    Returns 0 or -1 if the pseudo terminal could not be opened
+*/
+int JetsonMX28Emulator::begin(int Servos, unsigned char FirstID)
+{
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if( (master_fd < 0) || (grantpt(master_fd) < 0) || (unlockpt(master_fd) < 0) ||
+        (ptsname_r(master_fd, slave_path, sizeof(slave_path)) != 0) )
+    {
+        printf("Unable to open a pseudo terminal\n");
+        disconnect();
+        return -1;
+    }
+
+    // Keeping the slave open lets clients come and go, it starts raw at 1 Mbps
+    slave_fd = open(slave_path, O_RDWR | O_NOCTTY);
+    if(slave_fd < 0)
+    {
+        printf("Unable to open %s\n", slave_path);
+        disconnect();
+        return -1;
+    }
+
+    struct termios options;
+    tcgetattr(slave_fd, &options);
+    cfmakeraw(&options);
+    cfsetispeed(&options, B1000000);
+    cfsetospeed(&options, B1000000);
+    tcsetattr(slave_fd, TCSANOW, &options);
+
+    for(int servo = 0; servo < Servos; servo++)
+        addServo(FirstID + servo);
+
+    last_update = monotonicMicros();
+
+    return 0;
+}
+
+void JetsonMX28Emulator::disconnect()
+{
+    stop();
+
+    if(slave_fd >= 0)
+        close(slave_fd);
+    if(master_fd >= 0)
+        close(master_fd);
+
+    slave_fd = master_fd = -1;
+}
+
+// Device to pass to JetsonMX28::begin()
+const char *JetsonMX28Emulator::path()
+{
+    return slave_path;
+}
+
+// Serves the bus on a background thread until stop()
+int JetsonMX28Emulator::start()
+{
+    if( running | (master_fd < 0) )
+        return -1;
+
+    running = true;
+    worker = std::thread(&JetsonMX28Emulator::run, this);
+
+    return 0;
+}
+
+void JetsonMX28Emulator::stop()
+{
+    if(!running)
+        return;
+
+    running = false;
+    worker.join();
+}
+
+void JetsonMX28Emulator::run()
+{
+    while(running)
+        poll(10);
+}
+
+/*
+    Waits up to Timeout milliseconds for instruction bytes and answers every complete packet.
+    Like a servo, a partial packet is dropped when no more bytes arrive in time. Status
+    packets that come due while waiting are sent, the wait ends early for them.
+    Returns the number of bytes read, 0 on timeout or -1 on error
+*/
+int JetsonMX28Emulator::poll(int Timeout)
+{
+    struct pollfd pending;
+    pending.fd = master_fd;
+    pending.events = POLLIN;
+
+    long long now = monotonicMicros();
+    sendDue(now);
+
+    long long until = now + (long long)Timeout * 1000;
+    bool replying = (outbox_count > 0) && (outbox[0].Due < until);
+    if(replying)
+        until = outbox[0].Due;
+
+    struct timespec wait;
+    wait.tv_sec = (until - now) / 1000000;
+    wait.tv_nsec = ((until - now) % 1000000) * 1000;
+
+    int ready = ppoll(&pending, 1, &wait, NULL);
+    if(ready <= 0)
+    {
+        if( (ready == 0) & !replying )
+            rx_count = 0;
+        sendDue(monotonicMicros());
+        return ready;
+    }
+
+    if(rx_count == MX_EMULATOR_BUFFER)
+        rx_count = 0;
+
+    int bytes = read(master_fd, rx_buffer + rx_count, MX_EMULATOR_BUFFER - rx_count);
+    if(bytes <= 0)
+        return (bytes < 0) & (errno == EAGAIN) ? 0 : -1;
+
+    rx_count += bytes;
+    process(monotonicMicros());
+    sendDue(monotonicMicros());
+
+    return bytes;
+}
+
+/*
+    Adds a servo with factory settings, except for the ID
+    Returns 0 or -1 if the ID is not valid
+*/
+int JetsonMX28Emulator::addServo(unsigned char ID)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return -1;
+
+    reset(ID);
+    servos[ID].Online = true;
+
+    return 0;
+}
+
+// An offline servo is still present but never answers
+void JetsonMX28Emulator::setOnline(unsigned char ID, bool Status)
+{
+    if(ID < MX_MAX_SERVOS)
+        servos[ID].Online = Status;
+}
+
+void JetsonMX28Emulator::setFaults(const MX28Faults &Faults)
+{
+    faults = Faults;
+}
+
+// Seed of the fault injection, runs with the same seed inject the same faults
+void JetsonMX28Emulator::setSeed(unsigned int Seed)
+{
+    seed = Seed;
+}
+
+/*
+    Control table of a servo, or NULL if there is none with that ID.
+    Only change it while the emulator is stopped.
+*/
+unsigned char *JetsonMX28Emulator::table(unsigned char ID)
+{
+    if( (ID >= MX_MAX_SERVOS) || !servos[ID].Present )
+        return NULL;
+
+    return servos[ID].Table;
+}
+
+// Number of valid instruction packets received
+long JetsonMX28Emulator::packets()
+{
+    return packet_count;
+}
+
+// Factory settings of the MX-28, centered and at rest
+void JetsonMX28Emulator::reset(unsigned char ID)
+{
+    MX28VirtualServo &servo = servos[ID];
+    unsigned char *Table = servo.Table;
+
+    memset(Table, 0, MX_TABLE_SIZE);
+    Table[MX_MODEL_NUMBER_L] = MX_MODEL_NUMBER;
+    Table[MX_VERSION] = 30;
+    Table[MX_ID] = ID;
+    Table[MX_BAUD_RATE] = 1;
+    Table[MX_RETURN_DELAY_TIME] = 250;
+    Table[MX_CCW_ANGLE_LIMIT_L] = 0xFF;
+    Table[MX_CCW_ANGLE_LIMIT_H] = 0x0F;
+    Table[MX_LIMIT_TEMPERATURE] = 80;
+    Table[MX_DOWN_LIMIT_VOLTAGE] = 60;
+    Table[MX_UP_LIMIT_VOLTAGE] = 160;
+    Table[MX_MAX_TORQUE_L] = 0xFF;
+    Table[MX_MAX_TORQUE_H] = 0x03;
+    Table[MX_RETURN_LEVEL] = 2;
+    Table[MX_ALARM_LED] = 36;
+    Table[MX_ALARM_SHUTDOWN] = 36;
+    Table[MX_CW_COMPLIANCE_SLOPE] = 32;
+    Table[MX_GOAL_POSITION_L] = 0x00;
+    Table[MX_GOAL_POSITION_H] = 0x08;
+    Table[MX_TORQUE_LIMIT_L] = 0xFF;
+    Table[MX_TORQUE_LIMIT_H] = 0x03;
+    Table[MX_PRESENT_POSITION_L] = 0x00;
+    Table[MX_PRESENT_POSITION_H] = 0x08;
+    Table[MX_PRESENT_VOLTAGE] = 120;
+    Table[MX_PRESENT_TEMPERATURE] = 32;
+
+    servo.Present = true;
+    servo.PendingLength = 0;
+    servo.Position = 2048;
+}
+
+/*
+    Moves every servo with torque on towards its goal position at its goal speed,
+    or turns it in wheel mode when both angle limits are 0
+*/
+void JetsonMX28Emulator::update(long long Now)
+{
+    double elapsed = (Now - last_update) / 1000000.0;
+    last_update = Now;
+
+    for(int ID = 0; ID < MX_MAX_SERVOS; ID++)
+    {
+        MX28VirtualServo &servo = servos[ID];
+        unsigned char *Table = servo.Table;
+        if( !servo.Present || !Table[MX_TORQUE_ENABLE] )
+            continue;
+
+        int Goal = Table[MX_GOAL_POSITION_L] | (Table[MX_GOAL_POSITION_H] << 8);
+        int Speed = Table[MX_GOAL_SPEED_L] | (Table[MX_GOAL_SPEED_H] << 8);
+        bool Wheel = !(Table[MX_CW_ANGLE_LIMIT_L] | Table[MX_CW_ANGLE_LIMIT_H] |
+                       Table[MX_CCW_ANGLE_LIMIT_L] | Table[MX_CCW_ANGLE_LIMIT_H]);
+        int Present = 0;
+        bool Moving;
+
+        if(Wheel)
+        {
+            double steps = (Speed & 1023) * MX_SPEED_STEPS * elapsed;
+            servo.Position += (Speed & 1024) ? -steps : steps;
+            while(servo.Position < 0)
+                servo.Position += 4096;
+            while(servo.Position >= 4096)
+                servo.Position -= 4096;
+
+            Moving = (Speed & 1023) != 0;
+            Present = Speed;
+        }
+        else
+        {
+            double rate = (Speed == 0) ? MX_EMULATOR_SPEED : Speed * MX_SPEED_STEPS;
+            if(rate > MX_EMULATOR_SPEED)
+                rate = MX_EMULATOR_SPEED;
+
+            double steps = rate * elapsed;
+            double distance = Goal - servo.Position;
+            if( (distance <= steps) & (distance >= -steps) )
+                servo.Position = Goal;
+            else
+                servo.Position += (distance > 0) ? steps : -steps;
+
+            Moving = servo.Position != Goal;
+            if(Moving)
+                Present = (int)(rate / MX_SPEED_STEPS) | ((distance < 0) ? 1024 : 0);
+        }
+
+        int Position = (int)servo.Position;
+        Table[MX_PRESENT_POSITION_L] = Position;
+        Table[MX_PRESENT_POSITION_H] = Position >> 8;
+        Table[MX_PRESENT_SPEED_L] = Present;
+        Table[MX_PRESENT_SPEED_H] = Present >> 8;
+        Table[MX_MOVING] = Moving;
+    }
+}
+
+// Baud rate the client set on the terminal, including custom rates set with BOTHER
+long JetsonMX28Emulator::lineBaud()
+{
+    struct MX28Termios2 options;
+    if(ioctl(slave_fd, MX_TCGETS2, &options) < 0)
+        return 0;
+
+    return options.c_ospeed;
+}
+
+// A servo only understands the line when the baud rates are within 3%
+bool JetsonMX28Emulator::listening(unsigned char ID)
+{
+    if( (ID >= MX_MAX_SERVOS) || !servos[ID].Present || !servos[ID].Online )
+        return false;
+    if(line_baud == 0)
+        return true;
+
+    long difference = servoBaud(servos[ID].Table[MX_BAUD_RATE]) - line_baud;
+    if(difference < 0)
+        difference = -difference;
+
+    return difference * 100 <= line_baud * MX_BAUD_TOLERANCE;
+}
+
+long JetsonMX28Emulator::wireTime(int Bytes)
+{
+    long Baud = (line_baud == 0) ? 1000000 : line_baud;
+    return ((long long)Bytes * MX_BITS_PER_BYTE * 1000000 + Baud - 1) / Baud;
+}
+
+double JetsonMX28Emulator::chance()
+{
+    return (double)rand_r(&seed) / RAND_MAX;
+}
+
+/*
+    Runs every complete instruction packet in the buffer and keeps a partial one
+    Returns the number of packets run
+*/
+int JetsonMX28Emulator::process(long long Received)
+{
+    int head = 0;
+    int Packets = 0;
+
+    line_baud = lineBaud();
+    update(Received);
+
+    while(rx_count - head >= 4)
+    {
+        if( (rx_buffer[head] != MX_START) | (rx_buffer[head + 1] != MX_START) |
+            (rx_buffer[head + 2] == MX_START) )
+        {
+            head++;
+            continue;
+        }
+
+        unsigned char ID = rx_buffer[head + 2];
+        int Length = rx_buffer[head + 3];
+        if(Length < 2)
+        {
+            head++;
+            continue;
+        }
+        if(rx_count - head < Length + 4)
+            break;
+
+        unsigned char Sum = 0;
+        for(int i = head + 2; i < head + Length + 3; i++)
+            Sum += rx_buffer[i];
+
+        if( ((~Sum)&0xFF) != rx_buffer[head + Length + 3] )
+        {
+            if( (ID != BROADCAST_ID) && listening(ID) && replies(ID, MX_WRITE_DATA) )
+                reply(ID, MX_ERROR_CHECKSUM, NULL, 0, Received + wireTime(Length + 4));
+        }
+        else
+        {
+            packet_count++;
+            execute(ID, rx_buffer[head + 4], rx_buffer + head + 5, Length - 2,
+                    Received + wireTime(Length + 4));
+            Packets++;
+        }
+
+        head += Length + 4;
+    }
+
+    rx_count -= head;
+    memmove(rx_buffer, rx_buffer + head, rx_count);
+
+    return Packets;
+}
+
+/*
+    Runs one instruction
+    @Received - time the last byte of the instruction packet was on the wire
+*/
+void JetsonMX28Emulator::execute(unsigned char ID, unsigned char Instruction, const unsigned char *Params, int Length, long long Received)
+{
+    if(ID == BROADCAST_ID)
+    {
+        if(Instruction == MX_SYNC_WRITE)
+        {
+            if(Length < 2)
+                return;
+
+            int Block = Params[1] + 1;
+            for(int i = 2; i + Block <= Length; i += Block)
+            {
+                unsigned char Target = Params[i];
+                if(listening(Target))
+                    writeTable(&Target, Params[0], Params + i + 1, Params[1]);
+            }
+        }
+        else if(Instruction == MX_BULK_READ)
+        {
+            // Each servo answers after the one before it, a missing one stops the chain
+            for(int i = 1; i + MX_BULK_READ_LENGTH <= Length; i += MX_BULK_READ_LENGTH)
+            {
+                int Count = Params[i];
+                unsigned char Target = Params[i + 1];
+                int Address = Params[i + 2];
+                if(!listening(Target))
+                    break;
+
+                long long Ready = Received + 2 * servos[Target].Table[MX_RETURN_DELAY_TIME];
+                if(Address + Count > MX_TABLE_SIZE)
+                    reply(Target, MX_ERROR_RANGE, NULL, 0, Ready);
+                else if(replies(Target, MX_READ_DATA))
+                    reply(Target, 0, servos[Target].Table + Address, Count, Ready);
+                Received = bus_free;
+            }
+        }
+        else
+        {
+            for(int Target = 0; Target < MX_MAX_SERVOS; Target++)
+            {
+                if(listening(Target))
+                    execute(Target, Instruction, Params, Length, -1);
+            }
+        }
+        return;
+    }
+
+    if(!listening(ID))
+        return;
+
+    MX28VirtualServo &servo = servos[ID];
+    unsigned char Error = 0;
+    const unsigned char *Data = NULL;
+    int Count = 0;
+
+    switch(Instruction)
+    {
+        case MX_PING:
+            break;
+
+        case MX_READ_DATA:
+            if( (Length < 2) || (Params[0] + Params[1] > MX_TABLE_SIZE) )
+                Error = MX_ERROR_RANGE;
+            else
+            {
+                Data = servo.Table + Params[0];
+                Count = Params[1];
+            }
+            break;
+
+        case MX_WRITE_DATA:
+            Error = (Length < 2) ? MX_ERROR_RANGE : writeTable(&ID, Params[0], Params + 1, Length - 1);
+            break;
+
+        case MX_REG_WRITE:
+            if( (Length < 2) || (Params[0] + Length - 1 > MX_TABLE_SIZE) )
+                Error = MX_ERROR_RANGE;
+            else
+            {
+                servo.PendingAddress = Params[0];
+                servo.PendingLength = Length - 1;
+                memcpy(servo.Pending, Params + 1, Length - 1);
+                servo.Table[MX_REGISTERED_INSTRUCTION] = 1;
+            }
+            break;
+
+        case MX_ACTION:
+            if(servo.PendingLength > 0)
+            {
+                int Pending = servo.PendingLength;
+                servo.PendingLength = 0;
+                servo.Table[MX_REGISTERED_INSTRUCTION] = 0;
+                Error = writeTable(&ID, servo.PendingAddress, servo.Pending, Pending);
+            }
+            break;
+
+        case MX_RESET:
+            // A factory reset also sets the ID back to 1
+            if(Received >= 0)
+                reply(ID, 0, NULL, 0, Received + 2 * servo.Table[MX_RETURN_DELAY_TIME]);
+            servo.Present = false;
+            addServo(1);
+            return;
+
+        default:
+            Error = MX_ERROR_INSTRUCTION;
+            break;
+    }
+
+    // Broadcast instructions never get an answer
+    if( (Received >= 0) && replies(ID, Instruction) )
+        reply(ID, Error, Data, Count, Received + 2 * servos[ID].Table[MX_RETURN_DELAY_TIME]);
+}
+
+/*
+    Writes Length bytes from Address, read only registers are left unchanged.
+    Writing MX_ID moves the servo and updates ID.
+    Returns the status error byte
+*/
+int JetsonMX28Emulator::writeTable(unsigned char *ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    if(Address + Length > MX_TABLE_SIZE)
+        return MX_ERROR_RANGE;
+
+    MX28VirtualServo &servo = servos[*ID];
+    for(int i = 0; i < Length; i++)
+    {
+        int Register = Address + i;
+        bool ReadOnly = (Register <= MX_VERSION) |
+                        ((Register >= MX_PRESENT_POSITION_L) & (Register <= MX_MOVING));
+        if(!ReadOnly)
+            servo.Table[Register] = Data[i];
+    }
+
+    // A goal turns the torque on
+    if( (Address <= MX_GOAL_POSITION_H) & (Address + Length > MX_GOAL_POSITION_L) )
+        servo.Table[MX_TORQUE_ENABLE] = 1;
+
+    unsigned char NewID = servo.Table[MX_ID];
+    if( (NewID != *ID) & (NewID < MX_MAX_SERVOS) )
+    {
+        servos[NewID] = servo;
+        servo.Present = false;
+        *ID = NewID;
+    }
+    else
+        servo.Table[MX_ID] = *ID;
+
+    return 0;
+}
+
+// Status return level 0 only answers PING, 1 also READ_DATA, 2 everything
+bool JetsonMX28Emulator::replies(unsigned char ID, unsigned char Instruction)
+{
+    int Level = servos[ID].Table[MX_RETURN_LEVEL];
+
+    if(Instruction == MX_PING)
+        return true;
+    if(Instruction == MX_READ_DATA)
+        return Level >= 1;
+    return Level >= 2;
+}
+
+/*
+    Queues a status packet to be sent once it would have fully arrived over the wire
+    @Ready - earliest time the servo starts to answer
+*/
+void JetsonMX28Emulator::reply(unsigned char ID, unsigned char Error, const unsigned char *Params, int Length, long long Ready)
+{
+    int Packet_Length = Length + MX_STATUS_LENGTH;
+
+    tx_buffer[0] = MX_START;
+    tx_buffer[1] = MX_START;
+    tx_buffer[2] = ID;
+    tx_buffer[3] = Length + 2;
+    tx_buffer[4] = Error;
+    if(Length > 0)
+        memcpy(tx_buffer + 5, Params, Length);
+
+    unsigned char Sum = 0;
+    for(int i = 2; i < Packet_Length - 1; i++)
+        Sum += tx_buffer[i];
+    tx_buffer[Packet_Length - 1] = ~Sum;
+
+    long long start = (Ready > bus_free) ? Ready : bus_free;
+    bus_free = start + wireTime(Packet_Length);
+    long long send = bus_free;
+
+    if( (faults.NoReply > 0) && (chance() < faults.NoReply) )
+        return;
+    if( (faults.BadChecksum > 0) && (chance() < faults.BadChecksum) )
+        tx_buffer[Packet_Length - 1] ^= 0x5A;
+    if( (faults.DropByte > 0) && (chance() < faults.DropByte) )
+    {
+        int Drop = rand_r(&seed) % Packet_Length;
+        memmove(tx_buffer + Drop, tx_buffer + Drop + 1, Packet_Length - Drop - 1);
+        Packet_Length--;
+    }
+    if( (faults.LateReply > 0) && (chance() < faults.LateReply) )
+        send += faults.LateDelay;
+
+    queueReply(tx_buffer, Packet_Length, send);
+}
+
+// Adds a status packet to the outbox, behind the ones due at the same time
+void JetsonMX28Emulator::queueReply(const unsigned char *Packet, int Length, long long Due)
+{
+    // Full, the earliest packet goes out early rather than being lost
+    if(outbox_count == MX_EMULATOR_REPLIES)
+        sendDue(outbox[0].Due);
+
+    int slot = outbox_count;
+    while( (slot > 0) && (outbox[slot - 1].Due > Due) )
+    {
+        outbox[slot] = outbox[slot - 1];
+        slot--;
+    }
+
+    outbox[slot].Due = Due;
+    outbox[slot].Length = Length;
+    memcpy(outbox[slot].Data, Packet, Length);
+    outbox_count++;
+}
+
+// Writes every status packet in the outbox that is due by Now
+void JetsonMX28Emulator::sendDue(long long Now)
+{
+    int sent = 0;
+    while( (sent < outbox_count) && (outbox[sent].Due <= Now) )
+    {
+        if(write(master_fd, outbox[sent].Data, outbox[sent].Length) < 0)
+            printf("Emulator TX error\n");
+        sent++;
+    }
+
+    if(sent == 0)
+        return;
+    outbox_count -= sent;
+    memmove(outbox, outbox + sent, outbox_count * sizeof(MX28PendingReply));
+}
@@ -0,0 +1,438 @@
+/*
+********************************************************************************************
+    Background I/O engine for the JetsonMX28 library
+    
+    MODIFICATIONS:
+    10/17/2026 - Created the engine
+    10/17/2026 - Broadcast writes and emergencyStop()
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#include "JetsonMX28Engine.h"
+
+static long long monotonicMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+JetsonMX28Engine::JetsonMX28Engine(JetsonMX28 &Bus) : bus(Bus)
+{
+    running = false;
+    cycle_count = 0;
+    period = MX_ENGINE_PERIOD;
+    stop_request = false;
+
+    for(unsigned int cell = 0; cell < MX_QUEUE_SIZE; cell++)
+        queue[cell].Sequence.store(cell, std::memory_order_relaxed);
+    queue_head = 0;
+    queue_tail = 0;
+    
+    for(int servo = 0; servo < MX_MAX_SERVOS; servo++)
+    {
+        snapshot[servo].Sequence = 0;
+        snapshot[servo].Stamp = 0;
+        watched[servo] = false;
+    }
+}
+
+JetsonMX28Engine::~JetsonMX28Engine()
+{
+    stop();
+}
+
+/*
+    Starts the engine thread, the bus must already be set up with begin()
+    @Period - cycle time in micro seconds
+*/
+int JetsonMX28Engine::start(long Period)
+{
+    if(running)
+        return -1;
+    
+    period = Period;
+    running = true;
+    worker = std::thread(&JetsonMX28Engine::run, this);
+    
+    return 0;
+}
+
+void JetsonMX28Engine::stop()
+{
+    if(!running)
+        return;
+    
+    running = false;
+    wake.notify_one();
+    worker.join();
+}
+
+// Adds or removes a servo from the telemetry read every cycle
+int JetsonMX28Engine::watch(unsigned char ID, bool Status)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return -1;
+    
+    watched[ID] = Status;
+    return 0;
+}
+
+/*
+    Queues a write of up to 4 bytes, never blocks. BROADCAST_ID writes every servo
+    with one packet after the writes queued before it.
+    Returns 0 or -1 if the queue is full
+*/
+int JetsonMX28Engine::write(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    if( ((ID >= MX_MAX_SERVOS) & (ID != BROADCAST_ID)) | (Length <= 0) | (Length > MX_COMMAND_DATA) )
+        return -1;
+    
+    unsigned int position = queue_head.load(std::memory_order_relaxed);
+    MX28QueueCell *cell;
+    
+    while(1)
+    {
+        cell = &queue[position & (MX_QUEUE_SIZE - 1)];
+        unsigned int sequence = cell->Sequence.load(std::memory_order_acquire);
+        int difference = (int)(sequence - position);
+        
+        if(difference == 0)
+        {
+            if(queue_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if(difference < 0)
+            return -1;                          // Full
+        else
+            position = queue_head.load(std::memory_order_relaxed);
+    }
+    
+    cell->Command.ID = ID;
+    cell->Command.Address = Address;
+    cell->Command.Length = Length;
+    memcpy(cell->Command.Data, Data, Length);
+    cell->Sequence.store(position + 1, std::memory_order_release);
+    
+    return 0;
+}
+
+int JetsonMX28Engine::move(unsigned char ID, int Position)
+{
+    unsigned char Data[2];
+    
+    Data[0] = Position;
+    Data[1] = Position >> 8;
+    
+    return write(ID, MX_GOAL_POSITION_L, Data, 2);
+}
+
+int JetsonMX28Engine::moveSpeed(unsigned char ID, int Position, int Speed)
+{
+    unsigned char Data[4];
+    
+    Data[0] = Position;
+    Data[1] = Position >> 8;
+    Data[2] = Speed;
+    Data[3] = Speed >> 8;
+    
+    return write(ID, MX_GOAL_POSITION_L, Data, 4);
+}
+
+int JetsonMX28Engine::torqueStatus(unsigned char ID, bool Status)
+{
+    unsigned char Data = Status;
+    
+    return write(ID, MX_TORQUE_ENABLE, &Data, 1);
+}
+
+// Queues a broadcast write of up to 4 bytes to every servo on the bus
+int JetsonMX28Engine::writeAll(unsigned char Address, const unsigned char *Data, int Length)
+{
+    return write(BROADCAST_ID, Address, Data, Length);
+}
+
+int JetsonMX28Engine::torqueAll(bool Status)
+{
+    return torqueStatus(BROADCAST_ID, Status);
+}
+
+/*
+    Turns the torque of every servo on the bus off without going through the queue.
+    The engine thread is woken and sends it before its next packet, commands queued
+    until then are dropped so none of them can turn the torque back on. A transaction
+    already on the bus is finished first, so the stop can wait for one BULK_READ and
+    the timeout of a silent servo in it. Without a running engine the stop is sent from
+    the calling thread.
+    Returns 0 or -1 on a UART error
+*/
+int JetsonMX28Engine::emergencyStop()
+{
+    if(!running)
+        return bus.emergencyStop();
+    
+    {
+        std::lock_guard<std::mutex> lock(wake_lock);
+        stop_request = true;
+    }
+    wake.notify_one();
+    
+    return 0;
+}
+
+/*
+    Copies the latest telemetry of a watched servo, never blocks on the bus
+    @Stamp - optional, CLOCK_MONOTONIC time in micro seconds the state was read
+    Returns 0 or -1 if the servo has not been read yet
+*/
+int JetsonMX28Engine::readState(unsigned char ID, MX28State *State, long long *Stamp)
+{
+    if(ID >= MX_MAX_SERVOS)
+        return -1;
+    
+    MX28Snapshot &entry = snapshot[ID];
+    unsigned int before, after;
+    int Values[7];
+    long long When;
+    
+    do
+    {
+        before = entry.Sequence.load(std::memory_order_acquire);
+        for(int value = 0; value < 7; value++)
+            Values[value] = entry.Values[value].load(std::memory_order_relaxed);
+        When = entry.Stamp.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = entry.Sequence.load(std::memory_order_relaxed);
+    } while( (before != after) | (before & 1) );
+    
+    if(When == 0)
+        return -1;
+    
+    State->Position    = Values[0];
+    State->Speed       = Values[1];
+    State->Load        = Values[2];
+    State->Voltage     = Values[3];
+    State->Temperature = Values[4];
+    State->Registered  = Values[5];
+    State->Moving      = Values[6];
+    if(Stamp)
+        *Stamp = When;
+    
+    return 0;
+}
+
+long long JetsonMX28Engine::cycles()
+{
+    return cycle_count;
+}
+
+// Takes the next command off the queue, only called by the engine thread
+int JetsonMX28Engine::pop(MX28Command *Command)
+{
+    MX28QueueCell &cell = queue[queue_tail & (MX_QUEUE_SIZE - 1)];
+    
+    if(cell.Sequence.load(std::memory_order_acquire) != queue_tail + 1)
+        return 0;
+    
+    *Command = cell.Command;
+    cell.Sequence.store(queue_tail + MX_QUEUE_SIZE, std::memory_order_release);
+    queue_tail++;
+    
+    return 1;
+}
+
+/*
+    Sends everything queued since the last cycle. Writes to the same register range
+    are merged into one SYNC_WRITE with the last value queued for each servo, groups
+    go out in the order they were first queued, all in one burst on the bus. A write
+    that overlaps another range already queued for its servo sends the groups first,
+    so the servo ends with the value queued last.
+*/
+void JetsonMX28Engine::sendCommands()
+{
+    int group_count = 0;
+    MX28Command Command;
+    
+    bus.beginBatch();
+    while(pop(&Command))
+    {
+        int group = 0;
+        while( (group < group_count) && ((groups[group].Address != Command.Address) | (groups[group].Length != Command.Length)) )
+            group++;
+        
+        if( (group == MX_MAX_GROUPS) | (Command.ID == BROADCAST_ID) || overlaps(group_count, Command) )
+        {
+            // Out of groups, or a write that must follow them, send what we have and start again
+            sendGroups(group_count);
+            group_count = 0;
+            group = 0;
+            
+            if(Command.ID == BROADCAST_ID)
+            {
+                bus.writeAll(Command.Address, Command.Data, Command.Length);
+                continue;
+            }
+        }
+
+        MX28Group &entry = groups[group];
+        if(group == group_count)
+        {
+            entry.Address = Command.Address;
+            entry.Length = Command.Length;
+            entry.Count = 0;
+            group_count++;
+        }
+        
+        int servo = 0;
+        while( (servo < entry.Count) && (entry.IDs[servo] != Command.ID) )
+            servo++;
+        if(servo == entry.Count)
+            entry.IDs[entry.Count++] = Command.ID;
+        memcpy(&entry.Data[servo * entry.Length], Command.Data, entry.Length);
+    }
+    
+    sendGroups(group_count);
+    bus.endBatch();
+}
+
+// True when one of the first Count groups writes part of Command's range with another range on the same servo
+bool JetsonMX28Engine::overlaps(int Count, const MX28Command &Command)
+{
+    for(int group = 0; group < Count; group++)
+    {
+        MX28Group &entry = groups[group];
+        if( ((entry.Address == Command.Address) & (entry.Length == Command.Length)) |
+            (entry.Address >= Command.Address + Command.Length) | (Command.Address >= entry.Address + entry.Length) )
+            continue;
+        
+        for(int servo = 0; servo < entry.Count; servo++)
+        {
+            if(entry.IDs[servo] == Command.ID)
+                return true;
+        }
+    }
+    
+    return false;
+}
+
+// Sends the first Count groups as SYNC_WRITE packets, split when they do not fit in one
+void JetsonMX28Engine::sendGroups(int Count)
+{
+    for(int group = 0; group < Count; group++)
+    {
+        MX28Group &entry = groups[group];
+        int max_servos = (MX_MAX_PACKET_LENGTH - MX_SYNC_WRITE_LENGTH) / (entry.Length + 1);
+        
+        for(int first = 0; first < entry.Count; first += max_servos)
+        {
+            int count = entry.Count - first;
+            if(count > max_servos)
+                count = max_servos;
+            bus.syncWrite(entry.Address, entry.Length, &entry.IDs[first], &entry.Data[first * entry.Length], count);
+        }
+    }
+}
+
+// Sends an emergency stop asked for by another thread and drops the commands queued before it
+void JetsonMX28Engine::checkStop()
+{
+    if(!stop_request.exchange(false))
+        return;
+    
+    bus.emergencyStop();
+    
+    MX28Command Command;
+    while(pop(&Command));
+}
+
+// Reads the state of every watched servo with BULK_READ requests
+void JetsonMX28Engine::readTelemetry()
+{
+    unsigned char IDs[MX_MAX_BULK];
+    unsigned char Addresses[MX_MAX_BULK];
+    unsigned char Lengths[MX_MAX_BULK];
+    int count = 0;
+    
+    for(int ID = 0; ID < MX_MAX_SERVOS; ID++)
+    {
+        if(watched[ID])
+        {
+            IDs[count] = ID;
+            Addresses[count] = MX_PRESENT_POSITION_L;
+            Lengths[count] = MX_STATE_LENGTH;
+            count++;
+        }
+        
+        if( (count == MX_MAX_BULK) | ((ID == MX_MAX_SERVOS - 1) & (count > 0)) )
+        {
+            bus.bulkRead(IDs, Addresses, Lengths, count);
+            for(int servo = 0; servo < count; servo++)
+            {
+                MX28State State;
+                if(bus.bulkReadState(IDs[servo], &State) == 0)
+                    publish(IDs[servo], &State);
+            }
+            count = 0;
+            
+            // A stop does not wait for the rest of the servos
+            checkStop();
+        }
+    }
+}
+
+// Seqlock write of one servo's telemetry
+void JetsonMX28Engine::publish(unsigned char ID, const MX28State *State)
+{
+    MX28Snapshot &entry = snapshot[ID];
+    unsigned int sequence = entry.Sequence.load(std::memory_order_relaxed);
+    
+    entry.Sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    entry.Values[0].store(State->Position, std::memory_order_relaxed);
+    entry.Values[1].store(State->Speed, std::memory_order_relaxed);
+    entry.Values[2].store(State->Load, std::memory_order_relaxed);
+    entry.Values[3].store(State->Voltage, std::memory_order_relaxed);
+    entry.Values[4].store(State->Temperature, std::memory_order_relaxed);
+    entry.Values[5].store(State->Registered, std::memory_order_relaxed);
+    entry.Values[6].store(State->Moving, std::memory_order_relaxed);
+    entry.Stamp.store(monotonicMicros(), std::memory_order_relaxed);
+    
+    entry.Sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void JetsonMX28Engine::run()
+{
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    
+    while(running)
+    {
+        checkStop();
+        sendCommands();
+        checkStop();
+        readTelemetry();
+        cycle_count++;
+        
+        next.tv_nsec += period * 1000;
+        while(next.tv_nsec >= 1000000000)
+        {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        
+        // Sleeps until the next cycle, an emergency stop or stop() wakes it early
+        std::chrono::steady_clock::time_point until(std::chrono::seconds(next.tv_sec) + std::chrono::nanoseconds(next.tv_nsec));
+        std::unique_lock<std::mutex> lock(wake_lock);
+        wake.wait_until(lock, until, [this] { return stop_request.load() | !running.load(); });
+    }
+    
+    checkStop();
+
+    // Do not drop goals queued just before stop()
+    sendCommands();
+}
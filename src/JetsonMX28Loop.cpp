@@ -0,0 +1,349 @@
+/*
+********************************************************************************************
+    Fixed-rate control loop runner for the JetsonMX28 library
+    
+    MODIFICATIONS:
+    10/17/2026 - Created the loop runner
+    10/17/2026 - Admission control against the bus time model
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#include "JetsonMX28Loop.h"
+#include <sched.h>
+#include <sys/mman.h>
+
+static long long monotonicMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+JetsonMX28Loop::JetsonMX28Loop(JetsonMX28 &Bus) : bus(Bus)
+{
+    servo_count = 0;
+    period = requested_period = MX_LOOP_PERIOD;
+    priority = 0;
+    cpu = -1;
+    lock_memory = 0;
+    send_speed = 0;
+    admission = MX_ADMIT_WARN;
+    model_time = 0;
+    
+    resetStats();
+}
+
+// Sets the servos read and written every cycle, goals start at their present position
+int JetsonMX28Loop::setServos(const unsigned char *ServoIDs, int Count)
+{
+    if( (Count < 0) | (Count > MX_MAX_BULK) )
+        return -1;
+    
+    for(int servo = 0; servo < Count; servo++)
+    {
+        IDs[servo] = ServoIDs[servo];
+        Addresses[servo] = MX_PRESENT_POSITION_L;
+        Lengths[servo] = MX_STATE_LENGTH;
+        Valid[servo] = 0;
+        Positions[servo] = -1;
+        Speeds[servo] = 0;
+    }
+    servo_count = Count;
+    
+    return 0;
+}
+
+// Period of the loop in micro seconds
+void JetsonMX28Loop::setPeriod(long Period)
+{
+    period = requested_period = Period;
+}
+
+// Runs the loop under SCHED_FIFO with this priority (1-99), 0 keeps the normal scheduler
+void JetsonMX28Loop::setRealtime(int Priority)
+{
+    priority = Priority;
+}
+
+// Pins the loop thread to one CPU, -1 lets it run anywhere
+void JetsonMX28Loop::setCPU(int CPU)
+{
+    cpu = CPU;
+}
+
+// Locks current and future memory so the loop never takes a page fault
+void JetsonMX28Loop::setLockMemory(bool Status)
+{
+    lock_memory = Status;
+}
+
+/*
+    Writes goal speeds with the positions from the first cycle on (SYNC_WRITE of 4 bytes
+    per servo instead of 2). Admission control predicts the cycle with what is set here.
+*/
+void JetsonMX28Loop::setSendSpeed(bool Status)
+{
+    send_speed = Status;
+}
+
+// What run() does when a cycle is predicted not to fit in the period, MX_ADMIT_OFF to MX_ADMIT_DEGRADE
+void JetsonMX28Loop::setAdmission(int Mode)
+{
+    admission = Mode;
+}
+
+/*
+    Predicts the bus time of a cycle, a BULK_READ of the state and a SYNC_WRITE of
+    positions and speeds, and applies the admission mode when it takes more than
+    MX_ADMIT_LOAD percent of the period given to setPeriod()
+    Returns 0 to run, -1 to refuse
+*/
+int JetsonMX28Loop::admit()
+{
+    MX28Workload Load;
+    memset(&Load, 0, sizeof(Load));
+    Load.SyncServos = servo_count;
+    Load.SyncLength = send_speed ? 4 : 2;        // syncMoveSpeed() or syncMove()
+    Load.BulkServos = servo_count;
+    Load.BulkLength = MX_STATE_LENGTH;
+    Load.ReturnDelay = -1;
+    
+    model_time = bus.predictCycle(Load);
+    if(model_time < 0)
+        return -1;
+
+    // Every run starts from the period asked for, not one an earlier run stretched
+    period = requested_period;
+    if( (admission == MX_ADMIT_OFF) | (model_time * 100 <= period * MX_ADMIT_LOAD) )
+        return 0;
+    
+    long fits = model_time * 100 / MX_ADMIT_LOAD + 1;
+    switch(admission)
+    {
+        case MX_ADMIT_REFUSE:
+            printf("LOOP error: a cycle needs %ld us of bus time, %ld us period refused\n", model_time, period);
+            return -1;
+            
+        case MX_ADMIT_DEGRADE:
+            printf("LOOP warning: a cycle needs %ld us of bus time, period %ld us stretched to %ld us\n", model_time, period, fits);
+            period = fits;
+            return 0;
+            
+        default:
+            printf("LOOP warning: a cycle needs %ld us of bus time, the %ld us period needs at least %ld us\n", model_time, period, fits);
+            return 0;
+    }
+}
+
+// Applies the real-time settings to the calling thread
+int JetsonMX28Loop::setup()
+{
+    int Result = 0;
+    
+    if(lock_memory && (mlockall(MCL_CURRENT | MCL_FUTURE) < 0))
+    {
+        perror("JetsonMX28Loop mlockall");
+        Result = -1;
+    }
+    
+    if(cpu >= 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if(sched_setaffinity(0, sizeof(set), &set) < 0)
+        {
+            perror("JetsonMX28Loop sched_setaffinity");
+            Result = -1;
+        }
+    }
+    
+    if(priority > 0)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        if(sched_setscheduler(0, SCHED_FIFO, &param) < 0)
+        {
+            perror("JetsonMX28Loop sched_setscheduler");
+            Result = -1;
+        }
+    }
+    
+    return Result;
+}
+
+/*
+    Runs read telemetry -> Callback -> write goals every period on the calling thread
+    @Cycles - number of cycles to run, 0 runs until the callback returns non zero
+    Returns 0, or -1 if a real-time setting could not be applied (the loop still ran)
+    or the admission control refused the period (the loop did not run)
+*/
+int JetsonMX28Loop::run(MX28LoopCallback Callback, void *User, long long Cycles)
+{
+    if(admit() < 0)
+        return -1;
+    
+    int Result = setup();
+    MX28LoopCycle Cycle;
+    
+    Cycle.Count = servo_count;
+    Cycle.IDs = IDs;
+    Cycle.States = States;
+    Cycle.Valid = Valid;
+    Cycle.Positions = Positions;
+    Cycle.Speeds = Speeds;
+    Cycle.SendSpeed = send_speed;
+    
+    long long wake = monotonicMicros() + period;
+    
+    for(long long cycle = 0; (Cycles == 0) | (cycle < Cycles); cycle++)
+    {
+        struct timespec until;
+        until.tv_sec = wake / 1000000;
+        until.tv_nsec = (wake % 1000000) * 1000;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+        
+        long late = monotonicMicros() - wake;
+        if(late < 0)
+            late = 0;
+        jitter[(late < MX_JITTER_BUCKETS) ? late : (MX_JITTER_BUCKETS - 1)]++;
+        if(late > max_jitter)
+            max_jitter = late;
+        
+        // Read telemetry
+        long long busy = monotonicMicros();
+        if(servo_count > 0)
+        {
+            bus.bulkRead(IDs, Addresses, Lengths, servo_count);
+            for(int servo = 0; servo < servo_count; servo++)
+            {
+                Valid[servo] = (bus.bulkReadState(IDs[servo], &States[servo]) == 0);
+                if(Valid[servo] & (Positions[servo] < 0))
+                    Positions[servo] = States[servo].Position;
+            }
+        }
+        
+        long bus_cycle = monotonicMicros() - busy;
+        
+        Cycle.Cycle = cycle_count;
+        Cycle.Time = wake;
+        int Stop = Callback(&Cycle, User);
+
+        // Write goals, servos that never answered have no goal yet
+        unsigned char GoalIDs[MX_MAX_BULK];
+        int GoalPositions[MX_MAX_BULK];
+        int GoalSpeeds[MX_MAX_BULK];
+        int goals = 0;
+        for(int servo = 0; servo < servo_count; servo++)
+        {
+            if(Positions[servo] < 0)
+                continue;
+            GoalIDs[goals] = IDs[servo];
+            GoalPositions[goals] = Positions[servo];
+            GoalSpeeds[goals] = Speeds[servo];
+            goals++;
+        }
+        busy = monotonicMicros();
+        if(goals > 0)
+        {
+            if(Cycle.SendSpeed)
+                bus.syncMoveSpeed(GoalIDs, GoalPositions, GoalSpeeds, goals);
+            else
+                bus.syncMove(GoalIDs, GoalPositions, goals);
+        }
+        bus_cycle += monotonicMicros() - busy;
+        bus_time += bus_cycle;
+        if(bus_cycle > max_bus_time)
+            max_bus_time = bus_cycle;
+
+        cycle_count++;
+        if(Stop)
+            break;
+        
+        // Skip the wake-ups this cycle ran over instead of bunching them up
+        wake += period;
+        long long now = monotonicMicros();
+        if(now > wake)
+        {
+            overrun_count++;
+            wake += ((now - wake) / period + 1) * period;
+        }
+    }
+    
+    return Result;
+}
+
+long long JetsonMX28Loop::cycles()
+{
+    return cycle_count;
+}
+
+long long JetsonMX28Loop::overruns()
+{
+    return overrun_count;
+}
+
+// Wake-up jitter in micro seconds below which Percentile (0-100) of the cycles fall
+long JetsonMX28Loop::jitterPercentile(double Percentile)
+{
+    long long total = 0;
+    for(int bucket = 0; bucket < MX_JITTER_BUCKETS; bucket++)
+        total += jitter[bucket];
+    if(total == 0)
+        return 0;
+    
+    long long target = (long long)(total * Percentile / 100.0 + 0.5);
+    if(target < 1)
+        target = 1;
+    
+    long long seen = 0;
+    for(int bucket = 0; bucket < MX_JITTER_BUCKETS; bucket++)
+    {
+        seen += jitter[bucket];
+        if(seen >= target)
+            return bucket;
+    }
+    
+    return MX_JITTER_BUCKETS - 1;
+}
+
+long JetsonMX28Loop::maxJitter()
+{
+    return max_jitter;
+}
+
+// Bus time of a cycle the model predicted when run() started, in micro seconds
+long JetsonMX28Loop::predictedBusTime()
+{
+    return model_time;
+}
+
+// Bus time measured per cycle, in micro seconds
+long JetsonMX28Loop::meanBusTime()
+{
+    return (cycle_count > 0) ? bus_time / cycle_count : 0;
+}
+
+void JetsonMX28Loop::resetStats()
+{
+    cycle_count = 0;
+    overrun_count = 0;
+    max_jitter = 0;
+    memset(jitter, 0, sizeof(jitter));
+    bus_time = 0;
+    max_bus_time = 0;
+}
+
+void JetsonMX28Loop::printStats()
+{
+    printf("cycles %lld overruns %lld jitter p50 %ld us p99 %ld us p99.9 %ld us max %ld us\n",
+           cycle_count, overrun_count, jitterPercentile(50), jitterPercentile(99),
+           jitterPercentile(99.9), max_jitter);
+    printf("bus time predicted %ld us, measured mean %ld us max %ld us of a %ld us period\n",
+           model_time, meanBusTime(), max_bus_time, period);
+}
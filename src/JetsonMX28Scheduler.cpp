@@ -0,0 +1,455 @@
+/*
+********************************************************************************************
+    Telemetry polling scheduler for the JetsonMX28 library
+
+    MODIFICATIONS:
+    10/17/2026 - Created the scheduler
+    10/17/2026 - Budget in bus time from the bus model, moving rates are planned
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#include "JetsonMX28Scheduler.h"
+
+static long long monotonicMicros()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+JetsonMX28Scheduler::JetsonMX28Scheduler(JetsonMX28 &Bus) : bus(Bus)
+{
+    period = MX_POLL_PERIOD;
+    load = MX_POLL_LOAD;
+
+    clear();
+}
+
+/*
+    Adds a register range of ID to read Rate times per second
+    @Priority   - higher priorities keep their rate when the bus can not carry all targets
+    @MovingRate - rate while the servo's MX_MOVING flag is set, 0 to always use Rate
+    Returns the target number or -1 if it does not fit
+*/
+int JetsonMX28Scheduler::add(unsigned char ID, unsigned char Address, unsigned char Length, double Rate, int Priority, double MovingRate)
+{
+    if( (target_count == MX_MAX_POLLS) | (ID >= MX_MAX_SERVOS) | (Length == 0) | (Address + Length > MX_TABLE_SIZE) | (Rate <= 0) )
+    {
+        printf("SCHEDULER error: can not poll ID %d address %d length %d at %.1f Hz\n", ID, Address, Length, Rate);
+        return -1;
+    }
+
+    MX28PollTarget &entry = targets[target_count];
+    memset(&entry, 0, sizeof(entry));
+    entry.ID = ID;
+    entry.Address = Address;
+    entry.Length = Length;
+    entry.Priority = Priority;
+    entry.Rate = Rate;
+    entry.MovingRate = MovingRate;
+    entry.Scale = 1;
+
+    // Keep the order by priority, equal priorities in the order they were added
+    int slot = target_count;
+    while( (slot > 0) && (targets[order[slot - 1]].Priority < Priority) )
+    {
+        order[slot] = order[slot - 1];
+        slot--;
+    }
+    order[slot] = target_count;
+
+    target_count++;
+    plan();
+
+    return target_count - 1;
+}
+
+// Removes every target
+void JetsonMX28Scheduler::clear()
+{
+    target_count = 0;
+    demand = 0;
+    memset(moving, 0, sizeof(moving));
+    resetStats();
+}
+
+// Tick of the scheduler in micro seconds, no target is read faster than this
+void JetsonMX28Scheduler::setPeriod(long Period)
+{
+    period = Period;
+    plan();
+}
+
+// Percent of the bus time the schedule may use, the rest is left for writes
+void JetsonMX28Scheduler::setLoad(int Percent)
+{
+    load = Percent;
+    plan();
+}
+
+// Bus model time of one BULK_READ of Servos ranges of Length bytes each
+long JetsonMX28Scheduler::bulkTime(int Servos, int Length)
+{
+    MX28Workload Load = {0, 0, 0, 0, false, 0, 0, Servos, Length, -1};
+
+    return bus.predictCycle(Load);
+}
+
+/*
+    Micro seconds one servo adds to a BULK_READ: its request entry, its return delay
+    and its status packet
+*/
+long JetsonMX28Scheduler::cost(int Length)
+{
+    return bulkTime(2, Length) - bulkTime(1, Length);
+}
+
+// Micro seconds of a BULK_READ without servos: host overhead, header, turnaround and latency timer
+long JetsonMX28Scheduler::overhead()
+{
+    return bulkTime(1, 0) - cost(0);
+}
+
+/*
+    Fits the target rates into the bus time budget, from the bus model at the current
+    baud rate and return delay. A target with a moving rate asks for the higher of its
+    two rates, the boost must fit when every servo moves. Every target first gets up
+    to MX_POLL_MIN_RATE, the rest is served from the highest priority down: the first
+    priority that does not fit has its rates scaled down to what is left and lower
+    ones stay at their minimum.
+    Returns the load the targets ask for in percent of the bus, over 100 when the bus
+    is too slow for them
+*/
+double JetsonMX28Scheduler::plan()
+{
+    double budget = 1000000.0 * load / 100.0;
+    double tick_rate = 1000000.0 / period;
+    double wanted[MX_MAX_POLLS];
+    double floor[MX_MAX_POLLS];
+    double peak[MX_MAX_POLLS];
+    long cost_of[MX_MAX_POLLS];
+
+    // Every tick pays for one BULK_READ
+    double left = budget - overhead() * tick_rate;
+    demand = overhead() * tick_rate;
+
+    double floors = 0;
+    for(int index = 0; index < target_count; index++)
+    {
+        MX28PollTarget &entry = targets[index];
+        peak[index] = (entry.MovingRate > entry.Rate) ? entry.MovingRate : entry.Rate;
+        wanted[index] = (peak[index] < tick_rate) ? peak[index] : tick_rate;
+        floor[index] = (wanted[index] < MX_POLL_MIN_RATE) ? wanted[index] : MX_POLL_MIN_RATE;
+
+        // The moving flag is read with the range while the boost is on
+        int last = entry.Address + entry.Length - 1;
+        if( (entry.MovingRate > 0) & (last < MX_MOVING) )
+            last = MX_MOVING;
+        cost_of[index] = cost(last - entry.Address + 1);
+
+        floors += floor[index] * cost_of[index];
+        demand += wanted[index] * cost_of[index];
+    }
+
+    double floor_scale = 1;
+    if(floors > left)
+        floor_scale = (left > 0) ? left / floors : 0;
+    left -= floors * floor_scale;
+
+    for(int first = 0; first < target_count; )
+    {
+        int priority = targets[order[first]].Priority;
+        int last = first;
+        double extra = 0;
+
+        while( (last < target_count) && (targets[order[last]].Priority == priority) )
+        {
+            extra += (wanted[order[last]] - floor[order[last]]) * cost_of[order[last]];
+            last++;
+        }
+
+        double scale = 1;
+        if(extra > left)
+            scale = (left > 0) ? left / extra : 0;
+        left -= extra * scale;
+
+        for(int index = first; index < last; index++)
+        {
+            int target = order[index];
+            targets[target].Scale = (floor[target] * floor_scale + (wanted[target] - floor[target]) * scale) / wanted[target];
+        }
+        first = last;
+    }
+
+    return demand / 10000.0;
+}
+
+// Reads per second Target gets now, after plan() and the moving boost
+double JetsonMX28Scheduler::rate(const MX28PollTarget &Target)
+{
+    double tick_rate = 1000000.0 / period;
+    double peak = (Target.MovingRate > Target.Rate) ? Target.MovingRate : Target.Rate;
+    double planned = ((peak < tick_rate) ? peak : tick_rate) * Target.Scale;
+
+    // plan() made room for the higher rate, the other one uses that room up to its own rate
+    double wanted = Target.Rate;
+    if( moving[Target.ID] & (Target.MovingRate > 0) )
+        wanted = Target.MovingRate;
+
+    return (wanted < planned) ? wanted : planned;
+}
+
+/*
+    Reads every target that is due with one BULK_READ, one register range per servo.
+    Targets that do not fit in the tick's bus time budget stay due for the next tick.
+    Targets late by more than their interval go first, then the highest priorities.
+    Returns the number of targets read or -1 on a bad request
+*/
+int JetsonMX28Scheduler::poll()
+{
+    unsigned char IDs[MX_MAX_BULK];
+    unsigned char Addresses[MX_MAX_BULK];
+    unsigned char Lengths[MX_MAX_BULK];
+    int picked[MX_MAX_POLLS];
+    int servo_count = 0;
+    int picked_count = 0;
+
+    long long now = monotonicMicros();
+    if(start_time == 0)
+        start_time = now;
+
+    long budget = period * load / 100;
+    long used = overhead();
+
+    // Due within half a tick is due now, waiting a whole tick would be later still
+    long long due = now + period / 2;
+
+    // Targets late by a whole interval go first, lowest priority first as they are
+    // the ones pushed back, then the rest by priority
+    for(int index = 0; index < 2 * target_count; index++)
+    {
+        int target = (index < target_count) ? order[target_count - 1 - index] : order[index - target_count];
+        MX28PollTarget &entry = targets[target];
+        if( (rate(entry) <= 0) | (entry.Next > due) )
+            continue;
+        bool late = (now - entry.Next) * rate(entry) >= 1000000;
+        if(late != (index < target_count))
+            continue;
+
+        int first = entry.Address;
+        int last = entry.Address + entry.Length - 1;
+        if( (entry.MovingRate > 0) & (last < MX_MOVING) )
+            last = MX_MOVING;       // The boost needs to know if the servo moves
+
+        int servo = 0;
+        while( (servo < servo_count) && (IDs[servo] != entry.ID) )
+            servo++;
+
+        long extra;
+        if(servo < servo_count)
+        {
+            int low = (first < Addresses[servo]) ? first : Addresses[servo];
+            int high = (last > Addresses[servo] + Lengths[servo] - 1) ? last : (Addresses[servo] + Lengths[servo] - 1);
+            extra = bus.wireTime((high - low + 1) - Lengths[servo]);
+            first = low;
+            last = high;
+        }
+        else
+            extra = cost(last - first + 1);
+
+        if( ((used + extra > budget) & (picked_count > 0)) | ((servo == servo_count) & (servo_count == MX_MAX_BULK)) )
+        {
+            entry.Deferred++;
+            continue;
+        }
+
+        if(servo == servo_count)
+        {
+            IDs[servo] = entry.ID;
+            servo_count++;
+        }
+        Addresses[servo] = first;
+        Lengths[servo] = last - first + 1;
+        used += extra;
+        picked[picked_count++] = target;
+    }
+
+    if(servo_count == 0)
+        return 0;
+
+    if(bus.bulkRead(IDs, Addresses, Lengths, servo_count) < 0)
+        return -1;
+
+    long long done = monotonicMicros();
+    busy_time += done - now;
+    tick_count++;
+
+    for(int servo = 0; servo < servo_count; servo++)
+    {
+        if( (Addresses[servo] <= MX_MOVING) & (Addresses[servo] + Lengths[servo] > MX_MOVING) )
+            moving[IDs[servo]] = (bus.bulkReadData(IDs[servo], MX_MOVING, 1) == 1);
+    }
+
+    int Answers = 0;
+    for(int index = 0; index < picked_count; index++)
+    {
+        MX28PollTarget &entry = targets[picked[index]];
+        entry.Polls++;
+
+        int answered = 1;
+        for(int byte = 0; (byte < entry.Length) & answered; byte++)
+        {
+            int value = bus.bulkReadData(entry.ID, entry.Address + byte, 1);
+            if(value < 0)
+                answered = 0;
+            else
+                entry.Data[byte] = value;
+        }
+        if(answered)
+        {
+            entry.Answers++;
+            entry.Time = done;
+            Answers++;
+        }
+
+        // Late targets are read once more, not in a burst to catch up
+        long long interval = (long long)(1000000.0 / rate(entry));
+        entry.Next += interval;
+        if(entry.Next < now)
+            entry.Next = now;
+    }
+
+    // A servo that started moving gets its boosted targets right away
+    for(int index = 0; index < target_count; index++)
+    {
+        MX28PollTarget &entry = targets[index];
+        if( moving[entry.ID] & (entry.MovingRate > 0) & (rate(entry) > 0) )
+        {
+            long long soon = now + (long long)(1000000.0 / rate(entry));
+            if(entry.Next > soon)
+                entry.Next = soon;
+        }
+    }
+
+    return Answers;
+}
+
+/*
+    Calls poll() every period on the calling thread
+    @Duration - micro seconds to run
+    Returns the number of targets read
+*/
+int JetsonMX28Scheduler::run(long long Duration)
+{
+    int Answers = 0;
+    long long wake = monotonicMicros();
+    long long end = wake + Duration;
+
+    while(wake < end)
+    {
+        int Result = poll();
+        if(Result > 0)
+            Answers += Result;
+
+        wake += period;
+        long long now = monotonicMicros();
+        if(now > wake)
+            wake += ((now - wake) / period + 1) * period;
+
+        struct timespec until;
+        until.tv_sec = wake / 1000000;
+        until.tv_nsec = (wake % 1000000) * 1000;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) == EINTR);
+    }
+
+    return Answers;
+}
+
+/*
+    Returns a 1 or 2 byte value of ID from the freshest target that covers it,
+    -1 if no target has read it yet
+*/
+int JetsonMX28Scheduler::latest(unsigned char ID, unsigned char Address, int Length)
+{
+    const MX28PollTarget *best = NULL;
+
+    for(int index = 0; index < target_count; index++)
+    {
+        const MX28PollTarget &entry = targets[index];
+        if( (entry.ID != ID) | (Address < entry.Address) | (Address + Length > entry.Address + entry.Length) | (entry.Time == 0) )
+            continue;
+        if( (best == NULL) || (entry.Time > best->Time) )
+            best = &entry;
+    }
+
+    if(best == NULL)
+        return -1;
+
+    int offset = Address - best->Address;
+    if(Length == 2)
+        return best->Data[offset] + (best->Data[offset + 1] << 8);
+    return best->Data[offset];
+}
+
+// Micro seconds since Target was last read, -1 if it never was
+long long JetsonMX28Scheduler::age(int Target)
+{
+    if( (Target < 0) | (Target >= target_count) || (targets[Target].Time == 0) )
+        return -1;
+
+    return monotonicMicros() - targets[Target].Time;
+}
+
+const MX28PollTarget &JetsonMX28Scheduler::target(int Target)
+{
+    return targets[Target];
+}
+
+// Answered reads per second of Target since the first poll() or resetStats()
+double JetsonMX28Scheduler::achievedRate(int Target)
+{
+    long long elapsed = monotonicMicros() - start_time;
+    if( (Target < 0) | (Target >= target_count) | (start_time == 0) | (elapsed <= 0) )
+        return 0;
+
+    return targets[Target].Answers * 1000000.0 / elapsed;
+}
+
+// Percent of the time since the first poll() the bus spent in the scheduler's reads
+double JetsonMX28Scheduler::utilisation()
+{
+    long long elapsed = monotonicMicros() - start_time;
+    if( (start_time == 0) | (elapsed <= 0) )
+        return 0;
+
+    return busy_time * 100.0 / elapsed;
+}
+
+void JetsonMX28Scheduler::resetStats()
+{
+    start_time = 0;
+    tick_count = 0;
+    busy_time = 0;
+
+    for(int index = 0; index < target_count; index++)
+        targets[index].Polls = targets[index].Answers = targets[index].Deferred = 0;
+}
+
+// Prints the wanted, planned and achieved rate of every target
+void JetsonMX28Scheduler::report(FILE *Output)
+{
+    fprintf(Output, "%d targets, %lld ticks, demand %.1f%% of the bus, %.1f%% used\n",
+            target_count, tick_count, demand / 10000.0, utilisation());
+
+    for(int index = 0; index < target_count; index++)
+    {
+        const MX28PollTarget &entry = targets[order[index]];
+        fprintf(Output, "ID %-3d address %-2d length %-2d priority %-2d target %7.1f Hz planned %7.1f Hz achieved %7.1f Hz deferred %lld\n",
+                entry.ID, entry.Address, entry.Length, entry.Priority, entry.Rate, rate(entry),
+                achievedRate(order[index]), entry.Deferred);
+    }
+}
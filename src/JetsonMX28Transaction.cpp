@@ -0,0 +1,267 @@
+/*
+********************************************************************************************
+    Staged multi-servo transactions for the JetsonMX28 library
+
+    MODIFICATIONS:
+    10/17/2026 - Created the transactions
+
+********************************************************************************************
+
+ORGANIZATION: Sparta Robotics
+
+*/
+
+#include "JetsonMX28Transaction.h"
+
+JetsonMX28Transaction::JetsonMX28Transaction(JetsonMX28 &Bus) : bus(Bus)
+{
+    clear();
+}
+
+/*
+    Stages Length bytes from Address for ID, written by the servo at commit()
+    Returns the servo's index in the transaction or -1 if the write does not fit
+*/
+int JetsonMX28Transaction::stage(unsigned char ID, unsigned char Address, const unsigned char *Data, int Length)
+{
+    if( (ID >= MX_MAX_SERVOS) | (Length <= 0) | (Length > MX_STAGE_DATA) | (Address + Length > MX_TABLE_SIZE) )
+    {
+        printf("TRANSACTION error: can not stage ID %d address %d length %d\n", ID, Address, Length);
+        return -1;
+    }
+
+    // A servo registers one instruction, a second one replaces the first
+    int index = slots[ID];
+    if(index < 0)
+    {
+        index = write_count++;
+        slots[ID] = index;
+    }
+
+    MX28StagedWrite &entry = writes[index];
+    entry.ID = ID;
+    entry.Address = Address;
+    entry.Length = Length;
+    memcpy(entry.Data, Data, Length);
+    entry.Status = MX_STAGE_STAGED;
+    entry.Error = 0;
+
+    return index;
+}
+
+int JetsonMX28Transaction::stage(unsigned char ID, int Position)
+{
+    unsigned char Data[2];
+
+    Data[0] = Position;
+    Data[1] = Position >> 8;
+
+    return stage(ID, MX_GOAL_POSITION_L, Data, 2);
+}
+
+int JetsonMX28Transaction::stage(unsigned char ID, int Position, int Speed)
+{
+    unsigned char Data[4];
+
+    Data[0] = Position;
+    Data[1] = Position >> 8;
+    Data[2] = Speed;
+    Data[3] = Speed >> 8;
+
+    return stage(ID, MX_GOAL_POSITION_L, Data, 4);
+}
+
+// Empties the transaction, instructions the servos already registered stay registered
+void JetsonMX28Transaction::clear()
+{
+    write_count = 0;
+    memset(slots, -1, sizeof(slots));
+}
+
+/*
+    Sends a REG_WRITE to every servo in the transaction. Writes nobody answers (status
+    return level below 2) go out in one burst, the others are acknowledged one by one.
+    Returns the number of servos whose REG_WRITE failed
+*/
+int JetsonMX28Transaction::send()
+{
+    bus.beginBatch();
+    for(int index = 0; index < write_count; index++)
+    {
+        MX28StagedWrite &entry = writes[index];
+        entry.Error = bus.regWrite(entry.ID, entry.Address, entry.Data, entry.Length);
+        entry.Status = (entry.Error == 0) ? MX_STAGE_SENT : MX_STAGE_FAILED;
+    }
+
+    // The unanswered writes are only on the wire after endBatch()
+    if(bus.endBatch() < 0)
+    {
+        for(int index = 0; index < write_count; index++)
+        {
+            if(writes[index].Status == MX_STAGE_SENT)
+            {
+                writes[index].Status = MX_STAGE_FAILED;
+                writes[index].Error = -1;
+            }
+        }
+    }
+
+    return failed();
+}
+
+/*
+    Reads MX_REGISTERED_INSTRUCTION of every servo that was sent its write, with one
+    BULK_READ per MX_MAX_BULK servos. A servo that does not answer stops the ones after
+    it in a BULK_READ, so they are asked again in a new one. Servos at status return
+    level 0 can not be asked and stay MX_STAGE_SENT.
+    Returns the number of servos that are not known to be registered
+*/
+int JetsonMX28Transaction::verify()
+{
+    unsigned char IDs[MX_MAX_BULK];
+    unsigned char Addresses[MX_MAX_BULK];
+    unsigned char Lengths[MX_MAX_BULK];
+    int indexes[MX_MAX_SERVOS];
+    int checked = 0;
+
+    // A failed acknowledgement does not mean the servo missed the write
+    for(int index = 0; index < write_count; index++)
+    {
+        if(writes[index].Status != MX_STAGE_STAGED)
+            indexes[checked++] = index;
+    }
+
+    int first = 0;
+    while(first < checked)
+    {
+        int Count = checked - first;
+        if(Count > MX_MAX_BULK)
+            Count = MX_MAX_BULK;
+
+        for(int servo = 0; servo < Count; servo++)
+        {
+            IDs[servo] = writes[indexes[first + servo]].ID;
+            Addresses[servo] = MX_REGISTERED_INSTRUCTION;
+            Lengths[servo] = 1;
+        }
+
+        // bulkRead() leaves out the servos that would not answer, the count it returns
+        // is not a position in IDs, so every servo is looked up
+        bus.bulkRead(IDs, Addresses, Lengths, Count);
+
+        int next = first + Count;
+        for(int servo = 0; servo < Count; servo++)
+        {
+            MX28StagedWrite &entry = writes[indexes[first + servo]];
+            if(bus.returnLevel(IDs[servo]) == 0)
+                continue;
+
+            int Registered = bus.bulkReadData(IDs[servo], MX_REGISTERED_INSTRUCTION, 1);
+            if(Registered >= 0)
+            {
+                entry.Status = Registered ? MX_STAGE_REGISTERED : MX_STAGE_NOT_REGISTERED;
+                continue;
+            }
+
+            // The servos after it waited for its reply, ask them again
+            entry.Status = MX_STAGE_NO_ANSWER;
+            next = first + servo + 1;
+            break;
+        }
+        first = next;
+    }
+
+    int Missing = 0;
+    for(int index = 0; index < write_count; index++)
+    {
+        if(writes[index].Status != MX_STAGE_REGISTERED)
+            Missing++;
+    }
+
+    return Missing;
+}
+
+/*
+    Sends one broadcast ACTION, every servo that registered its write carries it out
+    at the same time
+    @Force - send it even if a servo failed, otherwise nothing is sent then
+    Returns 0 or -1 if a servo failed and the ACTION was not sent
+*/
+int JetsonMX28Transaction::commit(bool Force)
+{
+    int Failed = failed();
+    if( (Failed > 0) & !Force )
+    {
+        printf("TRANSACTION error: %d of %d servos did not register, not committed\n", Failed, write_count);
+        return -1;
+    }
+
+    bus.action();
+
+    for(int index = 0; index < write_count; index++)
+    {
+        if(writes[index].Status > MX_STAGE_STAGED)
+            writes[index].Status = MX_STAGE_COMMITTED;
+    }
+
+    return 0;
+}
+
+/*
+    Sends, verifies when asked, and commits the transaction
+    Returns 0 or -1 if a servo failed and the ACTION was not sent
+*/
+int JetsonMX28Transaction::execute(bool Verify)
+{
+    send();
+    if(Verify)
+        verify();
+
+    return commit();
+}
+
+// Status of ID, MX_STAGE_NONE when it is not in the transaction
+int JetsonMX28Transaction::status(unsigned char ID)
+{
+    if( (ID >= MX_MAX_SERVOS) || (slots[ID] < 0) )
+        return MX_STAGE_NONE;
+
+    return writes[slots[ID]].Status;
+}
+
+// Number of servos with a failed status
+int JetsonMX28Transaction::failed()
+{
+    int Failed = 0;
+    for(int index = 0; index < write_count; index++)
+    {
+        if(writes[index].Status < 0)
+            Failed++;
+    }
+
+    return Failed;
+}
+
+int JetsonMX28Transaction::count()
+{
+    return write_count;
+}
+
+const MX28StagedWrite &JetsonMX28Transaction::entry(int Index)
+{
+    return writes[Index];
+}
+
+void JetsonMX28Transaction::report(FILE *Output)
+{
+    static const char *names[] = {"no answer", "not registered", "failed", "staged", "sent", "registered", "committed"};
+
+    fprintf(Output, "%d servos, %d failed\n", write_count, failed());
+
+    for(int index = 0; index < write_count; index++)
+    {
+        const MX28StagedWrite &entry = writes[index];
+        fprintf(Output, "ID %-3d address %-2d length %d %s, error %d\n",
+                entry.ID, entry.Address, entry.Length, names[entry.Status - MX_STAGE_NO_ANSWER], entry.Error);
+    }
+}
@@ -7,6 +7,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
 #include "jetsonGPIO.h"
 
 
@@ -259,3 +261,113 @@ int gpioActiveLow ( jetsonGPIO gpio, unsigned int value )
     return 0;
 }
 
+//
+// gpioOpenValue
+// Open the value attribute of an exported pin for writing and keep it open
+// so gpioWriteValue can drive the pin without reopening the file
+// Returns the file descriptor of the named pin
+int gpioOpenValue ( jetsonGPIO gpio )
+{
+    int fileDescriptor;
+    char commandBuffer[MAX_BUF];
+
+    snprintf(commandBuffer, sizeof(commandBuffer), SYSFS_GPIO_DIR "/gpio%d/value", gpio);
+
+    fileDescriptor = open(commandBuffer, O_WRONLY);
+    if (fileDescriptor < 0) {
+        char errorBuffer[128] ;
+        snprintf(errorBuffer,sizeof(errorBuffer), "gpioOpenValue unable to open gpio%d",gpio) ;
+        perror(errorBuffer);
+    }
+    return fileDescriptor;
+}
+
+//
+// gpioWriteValue
+// Set the value of a pin opened with gpioOpenValue to 1 or 0 with a single pwrite
+// Return: Success = 0 ; otherwise -1
+int gpioWriteValue ( int fileDescriptor, unsigned int value )
+{
+    if (pwrite(fileDescriptor, value ? "1" : "0", 1, 0) != 1) {
+        perror("gpioWriteValue") ;
+        return -1 ;
+    }
+    return 0;
+}
+
+//
+// gpioLineOpen
+// Request a line of a GPIO character device (e.g. "/dev/gpiochip0") as an output
+// driven low; works with gpio-sim and gpio-mockup chips as well as real ones
+// Returns the file descriptor of the line ; otherwise -1
+int gpioLineOpen ( const char *chip, unsigned int line )
+{
+    int chipDescriptor, result;
+
+    chipDescriptor = open(chip, O_RDWR | O_CLOEXEC);
+    if (chipDescriptor < 0) {
+        char errorBuffer[128] ;
+        snprintf(errorBuffer,sizeof(errorBuffer), "gpioLineOpen unable to open %s",chip) ;
+        perror(errorBuffer);
+        return -1;
+    }
+
+#ifdef GPIO_V2_GET_LINE_IOCTL
+    struct gpio_v2_line_request request;
+    memset(&request, 0, sizeof(request));
+    request.offsets[0] = line;
+    request.num_lines = 1;
+    strncpy(request.consumer, "jetsonGPIO", sizeof(request.consumer) - 1);
+    request.config.flags = GPIO_V2_LINE_FLAG_OUTPUT;
+    request.config.num_attrs = 1;
+    request.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+    request.config.attrs[0].attr.values = 0;
+    request.config.attrs[0].mask = 1;
+    result = ioctl(chipDescriptor, GPIO_V2_GET_LINE_IOCTL, &request);
+#else
+    struct gpiohandle_request request;
+    memset(&request, 0, sizeof(request));
+    request.lineoffsets[0] = line;
+    request.lines = 1;
+    request.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    request.default_values[0] = 0;
+    strncpy(request.consumer_label, "jetsonGPIO", sizeof(request.consumer_label) - 1);
+    result = ioctl(chipDescriptor, GPIO_GET_LINEHANDLE_IOCTL, &request);
+#endif
+    close(chipDescriptor);
+
+    if (result < 0) {
+        char errorBuffer[128] ;
+        snprintf(errorBuffer,sizeof(errorBuffer), "gpioLineOpen unable to request line %d of %s",line,chip) ;
+        perror(errorBuffer);
+        return -1;
+    }
+    return request.fd;
+}
+
+//
+// gpioLineSetValue
+// Set the value of a line opened with gpioLineOpen to 1 or 0 with a single ioctl
+// Return: Success = 0 ; otherwise -1
+int gpioLineSetValue ( int fileDescriptor, unsigned int value )
+{
+    int result;
+
+#ifdef GPIO_V2_GET_LINE_IOCTL
+    struct gpio_v2_line_values values;
+    values.bits = value ? 1 : 0;
+    values.mask = 1;
+    result = ioctl(fileDescriptor, GPIO_V2_LINE_SET_VALUES_IOCTL, &values);
+#else
+    struct gpiohandle_data values;
+    memset(&values, 0, sizeof(values));
+    values.values[0] = value ? 1 : 0;
+    result = ioctl(fileDescriptor, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &values);
+#endif
+
+    if (result < 0) {
+        perror("gpioLineSetValue") ;
+        return -1 ;
+    }
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+    Self-checking tests of the library against virtual MX28-AT servos, no hardware needed
+
+	*Covers reads on a clean bus, recovery from lost and late replies, offline servos,
+	 the shadow control table, transactions and switching the bus baud rate
+	*Exits with the number of failed checks, 0 when everything passed ("make test")
+*/
+
+#include<iostream>
+#include "JetsonMX28Emulator.h"
+#include "JetsonMX28Transaction.h"
+
+#define SERVOS 4    // Number of virtual servos
+#define READS 400   // Reads per test
+#define MSEC 1000	// 1 milli second in micro second units for delay
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool Passed, const char *Name)
+{
+    cout << (Passed ? "PASS " : "FAIL ") << Name << endl;
+    if(!Passed)
+        failures++;
+}
+
+// Number of READS position reads over all servos that got an answer
+static int readAll(JetsonMX28 &control, const unsigned char *IDs, int Count)
+{
+    int Good = 0;
+    for(int i = 0; i < READS; i++)
+    {
+        if(control.readPosition(IDs[i % Count]) >= 0)
+            Good++;
+    }
+    return Good;
+}
+
+int main()
+{
+    JetsonMX28Emulator emulator;
+    JetsonMX28 control;
+    MX28Faults Clean = {0, 0, 0, 0, 0};
+
+    unsigned char IDs[SERVOS] = {1, 2, 3, 4};
+    unsigned char Addresses[SERVOS] = {MX_PRESENT_POSITION_L, MX_PRESENT_POSITION_L, MX_PRESENT_POSITION_L, MX_PRESENT_POSITION_L};
+    unsigned char Lengths[SERVOS] = {2, 2, 2, 2};
+
+    if( (emulator.begin(SERVOS) < 0) || (emulator.start() < 0) )
+        return 1;
+    emulator.setSeed(7);
+    if(control.begin(emulator.path(), B1000000) < 0)
+        return 1;
+    control.setAdaptiveTimeout(false);
+
+    for(int servo = 0; servo < SERVOS; servo++)
+        control.setRDT(IDs[servo], 0);
+
+    // Clean bus
+    check(readAll(control, IDs, SERVOS) == READS, "clean bus reads");
+    check(control.bulkRead(IDs, Addresses, Lengths, SERVOS) == SERVOS, "clean bus bulk read");
+    emulator.stop();                                        // The tables are only touched while stopped
+    check(control.bulkReadData(4, MX_PRESENT_POSITION_L, 2) == emulator.table(4)[MX_PRESENT_POSITION_L] + (emulator.table(4)[MX_PRESENT_POSITION_H] << 8),
+          "bulk read data matches the servo");
+    emulator.start();
+
+    // Out of range values are refused on both write paths, without a packet
+    long Sent = emulator.packets();
+    unsigned char Goal[4] = {0x00, 0x08, 0x00, 0x10};      // Position 2048, speed 4096
+    check(control.write<MX28Reg::GoalPosition>(1, 4096) == -MX_ERROR_RANGE, "write<Reg> refuses out of range");
+    check(control.writeRange<MX28Reg::GoalPosition, MX28Reg::GoalSpeed>(1, Goal) == -MX_ERROR_RANGE, "writeRange refuses out of range");
+    check(emulator.packets() == Sent, "nothing sent for out of range values");
+    Goal[3] = 0x01;
+    check(control.writeRange<MX28Reg::GoalPosition, MX28Reg::GoalSpeed>(1, Goal) == 0, "writeRange sends values in range");
+
+    // The shadow skips writes of values the servo holds and joins dirty runs in a batch
+    control.enableShadow(true);
+    control.refresh(1);
+    long long Suppressed = control.stats().Suppressed;
+    control.ledStatus(1, ON);
+    Sent = emulator.packets();
+    control.ledStatus(1, ON);
+    check( (emulator.packets() == Sent) & (control.stats().Suppressed == Suppressed + 1), "duplicate write suppressed and counted");
+
+    control.beginBatch();
+    control.torqueStatus(1, ON);                            // Address 24
+    control.write<MX28Reg::GoalSpeed>(1, 5);                // Low byte at 32, 7 bytes apart
+    control.endBatch();
+    check(emulator.packets() == Sent + 1, "dirty runs 7 bytes apart sent as one packet");
+
+    Sent = emulator.packets();
+    control.beginBatch();
+    control.torqueStatus(1, OFF);                           // Address 24
+    control.write<MX28Reg::GoalSpeed>(1, 5 + 256);          // High byte only at 33, 8 bytes apart
+    control.endBatch();
+    check(emulator.packets() == Sent + 2, "dirty runs 8 bytes apart sent as two packets");
+
+    emulator.stop();
+    check( (emulator.table(1)[MX_TORQUE_ENABLE] == 0) & (emulator.table(1)[MX_GOAL_SPEED_L] == 5) & (emulator.table(1)[MX_GOAL_SPEED_H] == 1),
+          "servo holds the batched values");
+    emulator.start();
+    control.enableShadow(false);
+
+    // A late reply of one servo must not hold up the next one
+    MX28Faults Late = {0, 0, 0, 1, 50*MSEC};
+    emulator.setFaults(Late);
+    check(control.readPosition(1) < 0, "late reply times out");
+    emulator.setFaults(Clean);
+    check(control.readPosition(2) >= 0, "next servo answers during a late reply");
+
+    // Lost, corrupted and late replies are recovered by retrying
+    MX28Faults Noisy = {0.02, 0.02, 0.02, 0.02, 20*MSEC};
+    emulator.setFaults(Noisy);
+    control.setRetries(2);
+    int Good = readAll(control, IDs, SERVOS);
+    cout << Good << " of " << READS << " reads on a noisy bus" << endl;
+    check(Good >= READS * 98 / 100, "noisy bus reads with retries");
+
+    // One read that failed all its attempts is one miss, not one per attempt
+    MX28Faults Silent = {1, 0, 0, 0, 0};
+    emulator.setFaults(Silent);
+    check(control.readPosition(1) < 0, "read fails on every attempt");
+    emulator.setFaults(Clean);
+    check(control.online(1), "one failed read with retries keeps the servo online");
+    check(control.readPosition(1) >= 0, "servo answers after one failed read");
+    control.setRetries(0);
+    usleep(50*MSEC);
+
+    // A servo that stops answering goes offline and comes back
+    emulator.setOnline(2, false);
+    for(int i = 0; i < MX_OFFLINE_MISSES; i++)
+        control.readPosition(2);
+    check(!control.online(2), "silent servo goes offline");
+    check(readAll(control, IDs + 2, 2) == READS, "other servos still answer");
+
+    // The offline servo is left out of BULK_READ, the servos after it keep reporting
+    for(int i = 0; i < MX_OFFLINE_MISSES; i++)
+        control.bulkRead(IDs, Addresses, Lengths, SERVOS);
+    check(control.bulkRead(IDs, Addresses, Lengths, SERVOS) == SERVOS - 1, "bulk read skips the offline servo");
+    check( (control.bulkReadData(3, MX_PRESENT_POSITION_L, 2) >= 0) & (control.bulkReadData(4, MX_PRESENT_POSITION_L, 2) >= 0),
+          "servos after the offline one report");
+    check(control.bulkReadData(2, MX_PRESENT_POSITION_L, 2) < 0, "offline servo has no bulk read data");
+
+    emulator.setOnline(2, true);
+    usleep(150*MSEC);
+    check(control.readPosition(2) >= 0, "servo answers after the offline retry");
+    check(control.online(2), "servo back online");
+
+    // Transactions: a servo at level 0 can not be verified, a missing one blocks the ACTION
+    JetsonMX28Transaction motion(control);
+    control.setSRL(1, 0);
+    emulator.setOnline(3, false);
+    for(int servo = 0; servo < SERVOS; servo++)
+        motion.stage(IDs[servo], 1000 + servo);
+    motion.send();
+    motion.verify();
+    check(motion.status(1) == MX_STAGE_SENT, "level 0 servo stays sent");
+    check( (motion.status(2) == MX_STAGE_REGISTERED) & (motion.status(4) == MX_STAGE_REGISTERED), "answering servos registered");
+    check(motion.status(3) == MX_STAGE_NO_ANSWER, "missing servo has no answer");
+    check(motion.commit() < 0, "commit refused with a missing servo");
+
+    emulator.setOnline(3, true);
+    motion.clear();
+    for(int servo = 0; servo < SERVOS; servo++)
+        motion.stage(IDs[servo], 3000 + servo);
+    check(motion.execute() == 0, "transaction committed");
+    check(motion.status(4) == MX_STAGE_COMMITTED, "servo status committed");
+    usleep(5*MSEC);
+    emulator.stop();
+    int Goals = 0;
+    for(int servo = 0; servo < SERVOS; servo++)
+        Goals += (emulator.table(IDs[servo])[MX_GOAL_POSITION_L] + (emulator.table(IDs[servo])[MX_GOAL_POSITION_H] << 8) == 3000 + servo);
+    emulator.start();
+    check(Goals == SERVOS, "every servo took its goal at the ACTION");
+    control.setSRL(1, 2);
+
+    // Probe reads ask the servo, not the cache
+    control.enableCache(true);
+    check(control.readSRL(1) == 2, "return level read");
+    emulator.stop();
+    emulator.table(1)[MX_RETURN_LEVEL] = 1;
+    emulator.start();
+    check(control.readSRL(1) == 1, "return level read again from the servo");
+    emulator.stop();
+    emulator.table(1)[MX_RETURN_LEVEL] = 2;
+    emulator.start();
+    check(control.readSRL(1) == 2, "return level restored");
+
+    // Baud switch of the whole bus, with the cache holding the baud rate register
+    check(control.switchBaudRate(IDs, SERVOS, 2250000) == 0, "switch to 2.25 Mbps");
+    check(control.baudRate() == 2250000, "host on 2.25 Mbps");
+    check(readAll(control, IDs, SERVOS) == READS, "reads at 2.25 Mbps");
+
+    emulator.setOnline(4, false);
+    check(control.switchBaudRate(IDs, SERVOS, 1000000) < 0, "switch refused with a servo missing");
+    check(control.baudRate() == 2250000, "host stays on 2.25 Mbps");
+    check(readAll(control, IDs, SERVOS - 1) == READS, "reads after the refused switch");
+    emulator.setOnline(4, true);
+
+    control.disconnect();
+    emulator.disconnect();
+
+    cout << failures << " checks failed" << endl;
+    return failures;
+}